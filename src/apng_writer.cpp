@@ -0,0 +1,246 @@
+//  apng_writer.cpp
+//
+//  Source code for APNG writer object functions
+
+
+#include <cstdlib>
+#include "apng_writer.hpp"
+
+static void put_u32(std::vector<unsigned char>* out, size_t pos, uint32_t value)
+{
+    // Store a 32-bit value in the big endian byte order PNG uses
+    (*out)[pos + 0] = (unsigned char)(value >> 24);
+    (*out)[pos + 1] = (unsigned char)(value >> 16);
+    (*out)[pos + 2] = (unsigned char)(value >> 8);
+    (*out)[pos + 3] = (unsigned char)(value);
+}
+
+
+APNG_Writer::APNG_Writer(std::string filename,
+                         size_t size,
+                         unsigned int num_frames,
+                         unsigned int fps,
+                         const std::vector<unsigned char>& palette)
+{
+    // The palette holds RGBA quadruplets for every color the frames use,
+    //   or is empty to store the frames as RGB
+    _palette = palette;
+    _size = size;
+    _num_frames = num_frames;
+    _fps = fps;
+    _frame_count = 0;
+    _sequence = 0;
+    _failed = false;
+    _ofs.open(filename.c_str(), std::ios::binary);
+    if (!_ofs)
+    {
+        std::cerr << "Could not open APNG file " << filename << std::endl;
+        _failed = true;
+    }
+}
+
+
+APNG_Writer::~APNG_Writer(void)
+{
+    if (_frame_count != _num_frames)
+        std::cerr << "APNG file closed after " << _frame_count << " of "
+                  << _num_frames << " frames" << std::endl;
+    _ofs.close();
+}
+
+
+bool APNG_Writer::add_frame(const uint8_t* rgba)
+{
+    // Returns false if the frame couldn't be written. The file is then
+    //   incomplete, so every later frame is refused too
+    if (_failed)
+        return false;
+
+    // Find the bounding box of the pixels that changed since the previous
+    //   frame, so only that region has to be encoded
+    size_t x0 = 0, y0 = 0, x1 = _size, y1 = _size;
+    if (_frame_count > 0)
+    {
+        x0 = _size;
+        y0 = _size;
+        x1 = 0;
+        y1 = 0;
+        const uint32_t* cur = (const uint32_t*)rgba;
+        const uint32_t* prev = (const uint32_t*)&_previous[0];
+        for (size_t y = 0; y < _size; y++)
+        {
+            const uint32_t* cur_row = cur + y * _size;
+            const uint32_t* prev_row = prev + y * _size;
+            size_t x = 0;
+            while (x < _size && cur_row[x] == prev_row[x])
+                x++;
+            if (x == _size)
+                continue;
+            size_t last = _size - 1;
+            while (cur_row[last] == prev_row[last])
+                last--;
+            if (x < x0) x0 = x;
+            if (last + 1 > x1) x1 = last + 1;
+            if (y < y0) y0 = y;
+            y1 = y + 1;
+        }
+        // APNG frames can't be empty, repeat a single unchanged pixel
+        if (x1 == 0)
+        {
+            x0 = 0;
+            y0 = 0;
+            x1 = 1;
+            y1 = 1;
+        }
+    }
+
+    // Encode the region as a regular PNG and take its chunks apart
+    std::vector<unsigned char> png;
+    if (!encode_region(rgba, x0, y0, x1 - x0, y1 - y0, &png))
+    {
+        _failed = true;
+        return false;
+    }
+    std::vector<unsigned char> image_data;
+    unsigned char* chunk = &png[8];
+    unsigned char* end = &png[0] + png.size();
+    bool wrote_header = false;
+    while (chunk + 12 <= end)
+    {
+        unsigned char* data = lodepng_chunk_data(chunk);
+        unsigned length = lodepng_chunk_length(chunk);
+        if (lodepng_chunk_type_equals(chunk, "IDAT"))
+            image_data.insert(image_data.end(), data, data + length);
+        else if (_frame_count == 0 && lodepng_chunk_type_equals(chunk, "IHDR"))
+        {
+            // The first frame is the full image, so its header is the
+            //   header of the animation, followed by the animation control
+            static const unsigned char signature[8] = {137, 80, 78, 71,
+                                                       13, 10, 26, 10};
+            _ofs.write((const char*)signature, 8);
+            _ofs.write((const char*)chunk, length + 12);
+            std::vector<unsigned char> actl(8);
+            put_u32(&actl, 0, _num_frames);
+            put_u32(&actl, 4, 0); // loop forever
+            write_chunk("acTL", actl);
+            wrote_header = true;
+        }
+        else if (_frame_count == 0 && !lodepng_chunk_type_equals(chunk, "IEND"))
+            _ofs.write((const char*)chunk, length + 12); // PLTE, tRNS
+        chunk = lodepng_chunk_next(chunk);
+    }
+    if (_frame_count == 0 && !wrote_header)
+    {
+        std::cerr << "APNG encoding error: missing IHDR chunk" << std::endl;
+        _failed = true;
+        return false;
+    }
+
+    // The first frame is stored as IDAT so that viewers without APNG
+    //   support still show it, later frames as fdAT with a sequence number
+    write_fctl(x0, y0, x1 - x0, y1 - y0);
+    if (_frame_count == 0)
+        write_chunk("IDAT", image_data);
+    else
+    {
+        std::vector<unsigned char> fdat(4);
+        put_u32(&fdat, 0, _sequence++);
+        fdat.insert(fdat.end(), image_data.begin(), image_data.end());
+        write_chunk("fdAT", fdat);
+    }
+
+    _frame_count++;
+    if (_frame_count == _num_frames)
+        write_chunk("IEND", std::vector<unsigned char>());
+    if (!_ofs)
+    {
+        std::cerr << "Could not write APNG frame " << _frame_count - 1
+                  << std::endl;
+        _failed = true;
+        return false;
+    }
+    // Only frames that were written are what the next one changes from
+    _previous.assign(rgba, rgba + _size * _size * 4);
+    return true;
+}
+
+
+bool APNG_Writer::encode_region(const uint8_t* rgba,
+                                size_t x, size_t y, size_t w, size_t h,
+                                std::vector<unsigned char>* png)
+{
+    // Copy the region to an RGB buffer. Every frame must use the color type
+    //   and palette of the first frame, so lodepng may not pick them per frame
+    std::vector<unsigned char> rgb(w * h * 3);
+    for (size_t j = 0; j < h; j++)
+    {
+        const uint8_t* src = rgba + ((y + j) * _size + x) * 4;
+        unsigned char* dst = &rgb[j * w * 3];
+        for (size_t i = 0; i < w; i++)
+        {
+            dst[i * 3 + 0] = src[i * 4 + 0];
+            dst[i * 3 + 1] = src[i * 4 + 1];
+            dst[i * 3 + 2] = src[i * 4 + 2];
+        }
+    }
+    lodepng::State state;
+    state.info_raw.colortype = LCT_RGB;
+    state.info_raw.bitdepth = 8;
+    state.info_png.color.colortype = LCT_RGB;
+    state.info_png.color.bitdepth = 8;
+    if (!_palette.empty())
+    {
+        state.info_png.color.colortype = LCT_PALETTE;
+        for (size_t i = 0; i + 3 < _palette.size(); i += 4)
+            lodepng_palette_add(&state.info_png.color,
+                                _palette[i + 0], _palette[i + 1],
+                                _palette[i + 2], _palette[i + 3]);
+    }
+    state.encoder.auto_convert = 0;
+    unsigned image_error = lodepng::encode(*png, rgb, w, h, state);
+    if (image_error)
+    {
+        std::cerr << "APNG encoding error: "
+                  << lodepng_error_text(image_error) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+void APNG_Writer::write_chunk(const char* type,
+                              const std::vector<unsigned char>& data)
+{
+    // Let lodepng add the length and CRC around the chunk data
+    unsigned char* chunk = NULL;
+    size_t chunk_size = 0;
+    unsigned error = lodepng_chunk_create(&chunk, &chunk_size,
+                                          (unsigned)data.size(), type,
+                                          data.empty() ? NULL : &data[0]);
+    if (error)
+        std::cerr << "APNG encoding error: " << lodepng_error_text(error)
+                  << std::endl;
+    else
+        _ofs.write((const char*)chunk, chunk_size);
+    free(chunk);
+}
+
+
+void APNG_Writer::write_fctl(size_t x, size_t y, size_t w, size_t h)
+{
+    // Frame control: the region replaces the same region of the previous
+    //   frame (blend source), and stays for the next one (dispose none)
+    std::vector<unsigned char> fctl(26, 0);
+    put_u32(&fctl, 0, _sequence++);
+    put_u32(&fctl, 4, (uint32_t)w);
+    put_u32(&fctl, 8, (uint32_t)h);
+    put_u32(&fctl, 12, (uint32_t)x);
+    put_u32(&fctl, 16, (uint32_t)y);
+    fctl[20] = 0; // delay numerator, 16 bits
+    fctl[21] = 1;
+    fctl[22] = (unsigned char)(_fps >> 8); // delay denominator, 16 bits
+    fctl[23] = (unsigned char)(_fps);
+    fctl[24] = 0; // APNG_DISPOSE_OP_NONE
+    fctl[25] = 0; // APNG_BLEND_OP_SOURCE
+    write_chunk("fcTL", fctl);
+}
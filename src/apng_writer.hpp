@@ -0,0 +1,44 @@
+//  apng_writer.hpp
+//
+//  Header file for APNG writer object, which streams the frames of an
+//   animation to a single lossless animated PNG file
+
+
+#ifndef APNG_WRITER_H
+#define APNG_WRITER_H
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <stdint.h>
+#include "lodepng.h"
+
+class APNG_Writer
+{
+    public:
+        APNG_Writer(std::string filename,
+                    size_t size,
+                    unsigned int num_frames,
+                    unsigned int fps,
+                    const std::vector<unsigned char>& palette);
+        ~APNG_Writer(void);
+        bool add_frame(const uint8_t* rgba);
+    private:
+        bool encode_region(const uint8_t* rgba,
+                           size_t x, size_t y, size_t w, size_t h,
+                           std::vector<unsigned char>* png);
+        void write_chunk(const char* type,
+                         const std::vector<unsigned char>& data);
+        void write_fctl(size_t x, size_t y, size_t w, size_t h);
+        std::ofstream _ofs;
+        size_t _size;
+        unsigned int _num_frames;
+        unsigned int _fps;
+        unsigned int _frame_count;
+        unsigned int _sequence;
+        bool _failed;   // a frame couldn't be written, refuse the rest
+        std::vector<unsigned char> _palette;
+        std::vector<uint8_t> _previous;
+};
+
+#endif // APNG_WRITER_H
@@ -0,0 +1,124 @@
+//  attracting_cycle.cpp
+//
+//  Source code for the attracting cycle search
+
+
+#include <complex>
+#include <vector>
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+#include "attracting_cycle.hpp"
+
+typedef std::complex<double> Complex;
+
+// Iterations of the critical point before looking for its cycle
+static const unsigned int CYCLE_SETTLE_ITERATIONS = 20000;
+static const unsigned int CYCLE_MAX_PERIOD = 64;
+static const unsigned int CYCLE_NEWTON_ITERATIONS = 50;
+
+
+static double chain_radius(const std::vector<Complex>& points, double radius,
+                           double error)
+{
+    // Radius of the disk around the next point of the cycle that holds the
+    //   images of a disk around a point: f(p + w) = f(p) + 2pw + w^2. Going
+    //   once around the cycle gives the radius the first disk maps into
+    for (size_t j = 0; j < points.size(); j++)
+        radius = (2.0 * std::abs(points[j]) + radius) * radius + error;
+    return radius;
+}
+
+
+bool find_attracting_cycle(double c_re, double c_im, Attracting_Cycle* cycle)
+{
+    cycle->re = 0.0;
+    cycle->im = 0.0;
+    cycle->radius = 0.0;
+    cycle->period = 0;
+
+    // If there is an attracting cycle, the orbit of the critical point 0
+    //   converges to it
+    Complex c(c_re, c_im);
+    Complex z(0.0, 0.0);
+    for (unsigned int i = 0; i < CYCLE_SETTLE_ITERATIONS; i++)
+    {
+        z = z * z + c;
+        if (std::abs(z) > 2.0)
+            return false;
+    }
+
+    // Take the first return close to the settled point as the period, then
+    //   refine the cycle point with Newton's method on f^p(z) - z
+    unsigned int period = 0;
+    Complex w = z;
+    for (unsigned int p = 1; p <= CYCLE_MAX_PERIOD && period == 0; p++)
+    {
+        w = w * w + c;
+        if (std::abs(w - z) < 1e-6 * (1.0 + std::abs(z)))
+            period = p;
+    }
+    if (period == 0)
+        return false;
+    for (unsigned int i = 0; i < CYCLE_NEWTON_ITERATIONS; i++)
+    {
+        Complex f = z;
+        Complex df = 1.0;
+        for (unsigned int j = 0; j < period; j++)
+        {
+            df *= 2.0 * f;
+            f = f * f + c;
+        }
+        Complex step = (f - z) / (df - 1.0);
+        z -= step;
+        if (std::abs(step) <= DBL_EPSILON * (1.0 + std::abs(z)))
+            break;
+    }
+
+    // The cycle attracts if its multiplier is inside the unit circle
+    std::vector<Complex> points(period);
+    Complex f = z;
+    Complex multiplier = 1.0;
+    for (unsigned int j = 0; j < period; j++)
+    {
+        points[j] = f;
+        multiplier *= 2.0 * f;
+        f = f * f + c;
+    }
+    if (!(std::abs(multiplier) < 1.0))
+        return false;
+
+    // Each step may add the error of the cycle points themselves (twice the
+    //   Newton residual) and the rounding of the kernel's double precision
+    //   z^2 + c for any z within the disks (radius at most 1)
+    double max_point = 0.0;
+    for (size_t j = 0; j < points.size(); j++)
+        max_point = std::max(max_point, std::abs(points[j]));
+    double error = 2.0 * std::abs(f - z) +
+                   4.0 * DBL_EPSILON * ((max_point + 1.0) * (max_point + 1.0) +
+                                        std::abs(c) + 1.0) + 1e-15;
+
+    // Find the largest radius (to within a factor of two, then refined by
+    //   bisection) whose disk maps strictly inside itself around the cycle,
+    //   so orbits that enter it can never escape
+    double radius = 0.5;
+    while (radius > 1e-12 && !(chain_radius(points, radius, error) < radius))
+        radius *= 0.5;
+    if (radius <= 1e-12)
+        return false;
+    double upper = std::min(2.0 * radius, 1.0);
+    for (unsigned int i = 0; i < 20; i++)
+    {
+        double mid = 0.5 * (radius + upper);
+        if (chain_radius(points, mid, error) < mid)
+            radius = mid;
+        else
+            upper = mid;
+    }
+
+    cycle->re = z.real();
+    cycle->im = z.imag();
+    cycle->radius = radius;
+    cycle->period = period;
+    return true;
+}
@@ -0,0 +1,25 @@
+//  attracting_cycle.hpp
+//
+//  Header file for the attracting cycle search, which finds the cycle that
+//   the interior of a julia set converges to, and a radius around it that
+//   orbits provably never leave
+
+
+#ifndef ATTRACTING_CYCLE_H
+#define ATTRACTING_CYCLE_H
+
+// Point of an attracting cycle of z^2 + c, and the radius of a disk around
+//   it whose orbits stay bounded forever (radius 0 if there is none)
+struct Attracting_Cycle
+{
+    double re;
+    double im;
+    double radius;
+    unsigned int period;
+};
+
+// Find the attracting cycle of z^2 + c with Newton's method, returns false
+//   (and a radius of 0) if c has none or no basin radius can be proven
+bool find_attracting_cycle(double c_re, double c_im, Attracting_Cycle* cycle);
+
+#endif // ATTRACTING_CYCLE_H
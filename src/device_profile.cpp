@@ -0,0 +1,122 @@
+//  device_profile.cpp
+//
+//  Source code for reading and writing device profiles
+
+
+#include <fstream>
+#include <sstream>
+#include <cctype>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "device_profile.hpp"
+
+
+void device_profile_init(Device_Profile* profile, const std::string& device,
+                         const std::string& driver)
+{
+    profile->device = device;
+    profile->driver = driver;
+    profile->size = 0;
+    profile->variant = -1;
+    profile->checked = 0;
+    profile->local_width = 0;
+    profile->local_height = 0;
+    profile->strip = 1;
+    profile->batch_frames = 0;
+    profile->flush_frames = 0;
+    profile->score_size = 0;
+    profile->score_seconds = 0.0;
+}
+
+
+std::string device_profile_path(const std::string& device,
+                                const std::string& driver)
+{
+    // Keep letters, digits, dots and dashes of the names, which is enough
+    //   to tell devices apart, the file itself holds the exact names
+    std::string name = device + "-" + driver;
+    for (size_t i = 0; i < name.size(); i++)
+    {
+        unsigned char ch = (unsigned char)name[i];
+        if (!isalnum(ch) && ch != '.' && ch != '-')
+            name[i] = '_';
+    }
+    return std::string(DEVICE_PROFILE_DIR) + "/" + name + ".txt";
+}
+
+
+bool load_device_profile(const std::string& filename,
+                         Device_Profile* profile)
+{
+    // One "key value" pair per line, values run to the end of the line
+    std::ifstream ifs(filename.c_str());
+    if (!ifs)
+        return false;
+    Device_Profile loaded;
+    device_profile_init(&loaded, "", "");
+    std::string line;
+    while (std::getline(ifs, line))
+    {
+        size_t space = line.find(' ');
+        if (space == std::string::npos)
+            continue;
+        std::string key = line.substr(0, space);
+        std::string value = line.substr(space + 1);
+        std::istringstream number(value);
+        if (key == "device")
+            loaded.device = value;
+        else if (key == "driver")
+            loaded.driver = value;
+        else if (key == "size")
+            number >> loaded.size;
+        else if (key == "variant")
+            number >> loaded.variant;
+        else if (key == "checked")
+            number >> loaded.checked;
+        else if (key == "local_size")
+            number >> loaded.local_width >> loaded.local_height;
+        else if (key == "strip")
+            number >> loaded.strip;
+        else if (key == "batch_frames")
+            number >> loaded.batch_frames;
+        else if (key == "flush_frames")
+            number >> loaded.flush_frames;
+        else if (key == "score")
+            number >> loaded.score_size >> loaded.score_seconds;
+    }
+    if (loaded.device != profile->device ||
+        loaded.driver != profile->driver || loaded.strip == 0 ||
+        (loaded.local_width == 0) != (loaded.local_height == 0))
+        return false;
+    *profile = loaded;
+    return true;
+}
+
+
+bool save_device_profile(const std::string& filename,
+                         const Device_Profile& profile)
+{
+    struct stat st = {0};
+    if (stat(DEVICE_PROFILE_DIR, &st) == -1)
+        mkdir(DEVICE_PROFILE_DIR, 0700);
+    std::ofstream ofs(filename.c_str());
+    if (!ofs)
+    {
+        std::cerr << "Could not write device profile " << filename
+                  << std::endl;
+        return false;
+    }
+    ofs << "device " << profile.device << "\n"
+        << "driver " << profile.driver << "\n"
+        << "size " << profile.size << "\n"
+        << "variant " << profile.variant << "\n"
+        << "checked " << profile.checked << "\n"
+        << "local_size " << profile.local_width << " "
+        << profile.local_height << "\n"
+        << "strip " << profile.strip << "\n"
+        << "batch_frames " << profile.batch_frames << "\n"
+        << "flush_frames " << profile.flush_frames << "\n"
+        << "score " << profile.score_size << " " << profile.score_seconds
+        << "\n";
+    return true;
+}
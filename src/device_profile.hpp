@@ -0,0 +1,54 @@
+//  device_profile.hpp
+//
+//  Header file for device profiles, which keep the launch shape and the
+//   arithmetic that rendered fastest on an OpenCL device, so later runs
+//   on the same device and driver can skip benchmarking them
+
+
+#ifndef DEVICE_PROFILE_H
+#define DEVICE_PROFILE_H
+
+#include <iostream>
+#include <string>
+
+// Directory the profiles are kept in, one text file per device and driver
+static const char DEVICE_PROFILE_DIR[] = "profiles";
+// Launch shapes are benchmarked on a centered crop of the first frame of
+//   at most this many pixels a side, for about this many seconds at most
+static const size_t TUNE_SIZE = 256;
+static const double TUNE_SECONDS = 2.0;
+
+// Settings that were fastest for frames of one size. Launch shapes must
+//   divide the frame evenly, so they are only reused at the same size
+struct Device_Profile
+{
+    std::string device;         // CL_DEVICE_NAME
+    std::string driver;         // CL_DRIVER_VERSION
+    size_t size;                // frame size the settings were tuned for
+    int variant;                // Kernel_Variant of plain frames, or -1
+    int checked;                // 1 if variant was only chosen from
+                                //   those with double's depths
+    size_t local_width;         // work group width, 0 lets the driver choose
+    size_t local_height;
+    unsigned int strip;         // pixels of a row per work item
+    unsigned int batch_frames;  // frames queued before waiting, 0 for all
+    unsigned int flush_frames;  // frames queued between flushes, 0 for none
+    size_t score_size;          // frame size of the score, 0 for no score
+    double score_seconds;       // seconds render_image took for a frame
+};
+
+// Fill in the device and driver of a profile, with settings that launch
+//   frames like before there were profiles
+void device_profile_init(Device_Profile* profile, const std::string& device,
+                         const std::string& driver);
+// File name of the profile of a device and driver
+std::string device_profile_path(const std::string& device,
+                                const std::string& driver);
+// Read a profile, which fails unless it is for the device and driver
+//   already filled in
+bool load_device_profile(const std::string& filename,
+                         Device_Profile* profile);
+bool save_device_profile(const std::string& filename,
+                         const Device_Profile& profile);
+
+#endif // DEVICE_PROFILE_H
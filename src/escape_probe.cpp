@@ -0,0 +1,59 @@
+//  escape_probe.cpp
+//
+//  Source code for escape probe functions
+
+
+#include <cmath>
+#include <algorithm>
+#include "escape_probe.hpp"
+
+
+unsigned int probe_iteration_limit(const std::vector<float>& spaced_re,
+                                   const std::vector<float>& spaced_im,
+                                   float c_re, float c_im,
+                                   const Attracting_Cycle& cycle,
+                                   double unresolved)
+{
+    // Histogram of the iterations the probed pixels take to escape, with
+    //   the same escape and cycle tests as julia_depth_cycle. Pixels that
+    //   never escape have the same depth at any limit, so aren't counted
+    size_t size = std::min(spaced_re.size(), spaced_im.size());
+    size_t side = std::min<size_t>(PROBE_SIZE, size);
+    unsigned int escaped[256] = {0};
+    double radius2 = cycle.radius * cycle.radius;
+    for (size_t j = 0; j < side; j++)
+    {
+        double y0 = spaced_im[(2 * j + 1) * size / (2 * side)];
+        for (size_t i = 0; i < side; i++)
+        {
+            double x = spaced_re[(2 * i + 1) * size / (2 * side)];
+            double y = y0;
+            for (unsigned int n = 0; n <= 255; n++)
+            {
+                if (!((float)std::sqrt(x * x + y * y) < 1000))
+                {
+                    escaped[n]++;
+                    break;
+                }
+                double d_re = x - cycle.re;
+                double d_im = y - cycle.im;
+                if (d_re * d_re + d_im * d_im < radius2)
+                    break;
+                double re = x * x - y * y + c_re;
+                y = 2.0 * x * y + c_im;
+                x = re;
+            }
+        }
+    }
+
+    // Lower the limit while the pixels escaping after it stay few enough
+    unsigned int allowed = (unsigned int)(unresolved * side * side);
+    unsigned int limit = 255;
+    unsigned int late = 0;
+    while (limit > 0 && late + escaped[limit] <= allowed)
+    {
+        late += escaped[limit];
+        limit--;
+    }
+    return limit;
+}
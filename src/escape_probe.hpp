@@ -0,0 +1,27 @@
+//  escape_probe.hpp
+//
+//  Header file for escape probes, which compute a few pixels of a frame on
+//   the host to find how many iterations the frame actually needs
+
+
+#ifndef ESCAPE_PROBE_H
+#define ESCAPE_PROBE_H
+
+#include <vector>
+#include "attracting_cycle.hpp"
+
+// Pixels per side of the evenly spread grid a probe computes
+static const unsigned int PROBE_SIZE = 32;
+// Fraction of probed pixels allowed to escape after the chosen limit
+static const double PROBE_UNRESOLVED = 0.001;
+
+// Smallest iteration limit (at most 255) after which at most a fraction
+//   unresolved of the probed pixels of a frame still escape. With the
+//   limit, those would get the depth of pixels that never escape
+unsigned int probe_iteration_limit(const std::vector<float>& spaced_re,
+                                   const std::vector<float>& spaced_im,
+                                   float c_re, float c_im,
+                                   const Attracting_Cycle& cycle,
+                                   double unresolved);
+
+#endif // ESCAPE_PROBE_H
@@ -0,0 +1,142 @@
+//  field_archive.cpp
+//
+//  Source code for iteration field archive writer and reader functions
+
+
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "field_archive.hpp"
+
+static const char FIELD_MAGIC[8] = {'J', 'U', 'L', 'I', 'A', 'F', 'L', 'D'};
+// Frames start on a cache line boundary
+static const uint32_t FIELD_DATA_OFFSET = 64;
+static_assert(sizeof(Field_Header) <= FIELD_DATA_OFFSET,
+              "Field_Header must fit before the first frame");
+
+
+void field_header_init(Field_Header* header)
+{
+    memset(header, 0, sizeof(Field_Header));
+    memcpy(header->magic, FIELD_MAGIC, sizeof(FIELD_MAGIC));
+    header->version = FIELD_ARCHIVE_VERSION;
+    header->data_offset = FIELD_DATA_OFFSET;
+    header->max_depth = 255;
+}
+
+
+Field_Archive_Writer::Field_Archive_Writer(std::string filename,
+                                           const Field_Header& header)
+{
+    _header = header;
+    _frame_count = 0;
+    _ofs.open(filename.c_str(), std::ios::binary);
+    if (!_ofs)
+    {
+        std::cerr << "Could not open field archive " << filename << std::endl;
+        return;
+    }
+    // Header, padded with zeros up to the first frame
+    char padding[FIELD_DATA_OFFSET] = {0};
+    _ofs.write((const char*)&_header, sizeof(Field_Header));
+    _ofs.write(padding, _header.data_offset - sizeof(Field_Header));
+}
+
+
+Field_Archive_Writer::~Field_Archive_Writer(void)
+{
+    if (_frame_count != _header.num_frames)
+        std::cerr << "Field archive closed after " << _frame_count << " of "
+                  << _header.num_frames << " frames" << std::endl;
+    _ofs.close();
+}
+
+
+void Field_Archive_Writer::add_frame(const uint8_t* depths)
+{
+    _ofs.write((const char*)depths, (size_t)_header.size * _header.size);
+    _frame_count++;
+}
+
+
+Field_Archive::Field_Archive(void)
+{
+    _map = NULL;
+    _map_size = 0;
+    memset(&_header, 0, sizeof(Field_Header));
+}
+
+
+Field_Archive::~Field_Archive(void)
+{
+    close();
+}
+
+
+bool Field_Archive::open(std::string filename)
+{
+    // Map the whole file read only, so frames are paged in from disk (or
+    //   the page cache) only as they are used
+    close();
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        std::cerr << "Could not open field archive " << filename << std::endl;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(Field_Header))
+    {
+        std::cerr << "Invalid field archive " << filename << std::endl;
+        ::close(fd);
+        return false;
+    }
+    _map_size = (size_t)st.st_size;
+    _map = mmap(NULL, _map_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (_map == MAP_FAILED)
+    {
+        std::cerr << "Could not map field archive " << filename << std::endl;
+        _map = NULL;
+        _map_size = 0;
+        return false;
+    }
+
+    // Check the header against the file before handing out frames
+    memcpy(&_header, _map, sizeof(Field_Header));
+    size_t frame_size = (size_t)_header.size * _header.size;
+    if (memcmp(_header.magic, FIELD_MAGIC, sizeof(FIELD_MAGIC)) != 0 ||
+        _header.version != FIELD_ARCHIVE_VERSION ||
+        _header.data_offset < sizeof(Field_Header) ||
+        _header.data_offset > _map_size ||
+        _header.size == 0 || _header.size > 65535 ||
+        (_map_size - _header.data_offset) / frame_size < _header.num_frames)
+    {
+        std::cerr << "Invalid field archive " << filename << std::endl;
+        close();
+        return false;
+    }
+    madvise(_map, _map_size, MADV_SEQUENTIAL);
+    return true;
+}
+
+
+const uint8_t* Field_Archive::frame(unsigned int i) const
+{
+    // Return the depths of frame i, valid while the archive is open
+    if (_map == NULL || i >= _header.num_frames)
+        return NULL;
+    return (const uint8_t*)_map + _header.data_offset +
+           (size_t)i * _header.size * _header.size;
+}
+
+
+void Field_Archive::close(void)
+{
+    if (_map != NULL)
+        munmap(_map, _map_size);
+    _map = NULL;
+    _map_size = 0;
+}
@@ -0,0 +1,73 @@
+//  field_archive.hpp
+//
+//  Header file for iteration field archives, which store the escape depth
+//   of every pixel of every frame so an animation can be recolored with
+//   any colormap without rendering it again
+
+
+#ifndef FIELD_ARCHIVE_H
+#define FIELD_ARCHIVE_H
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <stdint.h>
+
+// Version of the archive layout written by Field_Archive_Writer
+static const uint32_t FIELD_ARCHIVE_VERSION = 1;
+
+// Fixed size header at the start of an archive, in host byte order. The
+//   frames follow at data_offset, num_frames * size * size depth bytes in
+//   frame, row, column order
+struct Field_Header
+{
+    char magic[8];            // "JULIAFLD"
+    uint32_t version;
+    uint32_t data_offset;
+    uint32_t size;
+    uint32_t num_frames;
+    uint32_t fps;
+    uint32_t max_depth;       // depth of points that never escape
+    float center_re;
+    float center_im;
+    float zoom;
+    float c_re;
+    float c_im;
+    float c_re_step;
+    float c_im_step;
+    uint32_t reserved;
+};
+
+class Field_Archive_Writer
+{
+    public:
+        Field_Archive_Writer(std::string filename, const Field_Header& header);
+        ~Field_Archive_Writer(void);
+        void add_frame(const uint8_t* depths);
+    private:
+        std::ofstream _ofs;
+        Field_Header _header;
+        unsigned int _frame_count;
+};
+
+class Field_Archive
+{
+    public:
+        Field_Archive(void);
+        ~Field_Archive(void);
+        bool open(std::string filename);
+        const Field_Header& header(void) const { return _header; }
+        const uint8_t* frame(unsigned int i) const;
+    private:
+        Field_Archive(const Field_Archive&);
+        Field_Archive& operator=(const Field_Archive&);
+        void close(void);
+        Field_Header _header;
+        void* _map;
+        size_t _map_size;
+};
+
+// Fill in the magic, version and data offset of an archive header
+void field_header_init(Field_Header* header);
+
+#endif // FIELD_ARCHIVE_H
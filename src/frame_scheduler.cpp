@@ -0,0 +1,99 @@
+//  frame_scheduler.cpp
+//
+//  Source code for frame scheduler object functions
+
+
+#include <algorithm>
+#include <cmath>
+#include "frame_scheduler.hpp"
+
+
+Frame_Scheduler::Frame_Scheduler(unsigned int num_frames,
+                                 unsigned int num_devices)
+{
+    _num_frames = num_frames;
+    _next_frame = 0;
+    _rendered.resize(num_devices, 0);
+    _frame_seconds.resize(num_devices, 0.0);
+    _active.resize(num_devices, true);
+    _timed.resize(num_devices, false);
+}
+
+
+bool Frame_Scheduler::take_frames(unsigned int device, unsigned int* first,
+                                  unsigned int* count)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    unsigned int left = _num_frames - _next_frame;
+    if (left == 0)
+        return false;
+    // Devices take one frame until they have been timed or estimated
+    unsigned int chunk = 1;
+    double seconds = _frame_seconds[device];
+    if (seconds > 0.0)
+    {
+        // Leave the last frames to the other devices when together they
+        //   would render all of them before this one renders one. The
+        //   fastest device left always keeps going, so every frame is
+        //   taken
+        double fastest = seconds;
+        double others_rate = 0.0;
+        for (unsigned int d = 0; d < _frame_seconds.size(); d++)
+        {
+            if (d == device || !_active[d] || _frame_seconds[d] == 0.0)
+                continue;
+            fastest = std::min(fastest, _frame_seconds[d]);
+            others_rate += 1.0 / _frame_seconds[d];
+        }
+        if (fastest < seconds && seconds * others_rate > left)
+        {
+            _active[device] = false;
+            return false;
+        }
+        // Chunks in proportion to speed, so every device waits about as
+        //   long for its frames
+        chunk = std::max(1u, (unsigned int)floor(SCHEDULE_CHUNK * fastest /
+                                                 seconds + 0.5));
+    }
+    *first = _next_frame;
+    *count = std::min(chunk, left);
+    _next_frame += *count;
+    return true;
+}
+
+
+void Frame_Scheduler::estimate(unsigned int device, double seconds)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_timed[device] && seconds > 0.0)
+        _frame_seconds[device] = seconds;
+}
+
+
+void Frame_Scheduler::report(unsigned int device, unsigned int count,
+                             double seconds)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _rendered[device] += count;
+    double per_frame = seconds / count;
+    if (!_timed[device])
+        _frame_seconds[device] = per_frame;
+    else
+        _frame_seconds[device] += SCHEDULE_SMOOTHING *
+                                  (per_frame - _frame_seconds[device]);
+    _timed[device] = true;
+}
+
+
+unsigned int Frame_Scheduler::frames_rendered(unsigned int device)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _rendered[device];
+}
+
+
+double Frame_Scheduler::frame_seconds(unsigned int device)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _frame_seconds[device];
+}
@@ -0,0 +1,44 @@
+//  frame_scheduler.hpp
+//
+//  Header file for the frame scheduler, which hands out the frames of an
+//   animation to several devices rendering at once, in chunks sized by
+//   how fast each device has been so far
+
+
+#ifndef FRAME_SCHEDULER_H
+#define FRAME_SCHEDULER_H
+
+#include <vector>
+#include <mutex>
+
+// Frames the fastest device takes at a time, slower devices take fewer
+static const unsigned int SCHEDULE_CHUNK = 4;
+// Weight of the newest chunk in a device's average seconds per frame
+static const double SCHEDULE_SMOOTHING = 0.5;
+
+class Frame_Scheduler
+{
+    public:
+        Frame_Scheduler(unsigned int num_frames, unsigned int num_devices);
+        // Next frames for a device to render, first to first + count - 1,
+        //   or false once there are none left it would finish in time
+        bool take_frames(unsigned int device, unsigned int* first,
+                         unsigned int* count);
+        // Seconds per frame to weigh a device by until it is timed
+        void estimate(unsigned int device, double seconds);
+        // Record how long a device took to render its last frames
+        void report(unsigned int device, unsigned int count,
+                    double seconds);
+        unsigned int frames_rendered(unsigned int device);
+        double frame_seconds(unsigned int device);
+    private:
+        std::mutex _mutex;
+        unsigned int _num_frames;
+        unsigned int _next_frame;
+        std::vector<unsigned int> _rendered;
+        std::vector<double> _frame_seconds; // 0 until measured
+        std::vector<bool> _timed;           // measured, not estimated
+        std::vector<bool> _active;          // still taking frames
+};
+
+#endif // FRAME_SCHEDULER_H
@@ -0,0 +1,292 @@
+//  gif_writer.cpp
+//
+//  Source code for GIF writer object functions
+
+
+#include <algorithm>
+#include <thread>
+#include "gif_writer.hpp"
+
+// Codes are written with at least 9 bits for 8-bit palette indices
+static const unsigned int LZW_MIN_CODE_SIZE = 8;
+static const unsigned int LZW_CLEAR_CODE = 1 << LZW_MIN_CODE_SIZE;
+static const unsigned int LZW_END_CODE = LZW_CLEAR_CODE + 1;
+static const unsigned int LZW_MAX_CODE = 4095;
+// Open addressing table of (prefix code, index) strings, at most half full
+static const unsigned int LZW_HASH_BITS = 13;
+
+
+struct LZW_Bits
+{
+    std::vector<uint8_t> data;
+    uint32_t buffer;
+    unsigned int count;
+
+    void write(unsigned int code, unsigned int code_size)
+    {
+        // GIF packs codes starting from the least significant bit
+        buffer |= (uint32_t)code << count;
+        count += code_size;
+        while (count >= 8)
+        {
+            data.push_back((uint8_t)buffer);
+            buffer >>= 8;
+            count -= 8;
+        }
+    }
+};
+
+
+static void lzw_encode(const std::vector<uint8_t>& in,
+                       std::vector<uint8_t>* out)
+{
+    // LZW compress palette indices into the GIF image data format: the
+    //   minimum code size, then the codes in sub-blocks of up to 255 bytes
+    const unsigned int hash_size = 1 << LZW_HASH_BITS;
+    std::vector<uint32_t> keys(hash_size, 0);
+    std::vector<uint16_t> codes(hash_size);
+    unsigned int code_size = LZW_MIN_CODE_SIZE + 1;
+    unsigned int max_code = LZW_END_CODE;
+    LZW_Bits bits;
+    bits.buffer = 0;
+    bits.count = 0;
+    bits.data.reserve(in.size() / 2);
+
+    bits.write(LZW_CLEAR_CODE, code_size);
+    unsigned int prefix = in.empty() ? 0 : in[0];
+    for (size_t i = 1; i < in.size(); i++)
+    {
+        // Extend the current string while it is in the table
+        uint32_t key = ((uint32_t)prefix << 8 | in[i]) + 1;
+        uint32_t slot = (key * 2654435761u) >> (32 - LZW_HASH_BITS);
+        while (keys[slot] != 0 && keys[slot] != key)
+            slot = (slot + 1) & (hash_size - 1);
+        if (keys[slot] == key)
+        {
+            prefix = codes[slot];
+            continue;
+        }
+
+        // Otherwise output its code and add the extended string
+        bits.write(prefix, code_size);
+        keys[slot] = key;
+        codes[slot] = (uint16_t)++max_code;
+        if (max_code >= (1u << code_size))
+            code_size++;
+        if (max_code == LZW_MAX_CODE)
+        {
+            // Table is full, start over
+            bits.write(LZW_CLEAR_CODE, code_size);
+            std::fill(keys.begin(), keys.end(), 0);
+            code_size = LZW_MIN_CODE_SIZE + 1;
+            max_code = LZW_END_CODE;
+        }
+        prefix = in[i];
+    }
+    if (!in.empty())
+        bits.write(prefix, code_size);
+    bits.write(LZW_END_CODE, code_size);
+    if (bits.count > 0)
+        bits.data.push_back((uint8_t)bits.buffer);
+
+    out->clear();
+    out->push_back(LZW_MIN_CODE_SIZE);
+    for (size_t i = 0; i < bits.data.size(); i += 255)
+    {
+        size_t n = std::min<size_t>(255, bits.data.size() - i);
+        out->push_back((uint8_t)n);
+        out->insert(out->end(), bits.data.begin() + i,
+                    bits.data.begin() + i + n);
+    }
+    out->push_back(0);
+}
+
+
+static void encode_frame(GIF_Frame* frame)
+{
+    lzw_encode(frame->indices, &frame->lzw);
+}
+
+
+GIF_Writer::GIF_Writer(std::string filename,
+                       size_t size,
+                       unsigned int num_frames,
+                       unsigned int fps,
+                       const std::vector<unsigned char>& palette)
+{
+    _size = size;
+    _num_frames = num_frames;
+    // GIF delays are in hundredths of a second
+    _delay = (100 + fps / 2) / fps;
+    _frame_count = 0;
+    // LZW code one frame per hardware thread at a time
+    _batch_size = std::max(1u, std::thread::hardware_concurrency());
+    _ofs.open(filename.c_str(), std::ios::binary);
+    if (!_ofs)
+    {
+        std::cerr << "Could not open GIF file " << filename << std::endl;
+        return;
+    }
+
+    // Header and logical screen descriptor with a 256 color global color
+    //   table, taken from the RGBA palette
+    _ofs.write("GIF89a", 6);
+    write_u16((unsigned int)_size);
+    write_u16((unsigned int)_size);
+    _ofs.put((char)0xF7);
+    _ofs.put(0); // background color index
+    _ofs.put(0); // no aspect ratio
+    for (unsigned int i = 0; i < 256; i++)
+    {
+        for (unsigned int j = 0; j < 3; j++)
+            _ofs.put(i * 4 + j < palette.size() ? palette[i * 4 + j] : 0);
+    }
+    // Netscape application extension to loop forever
+    _ofs.write("\x21\xFF\x0BNETSCAPE2.0\x03\x01", 16);
+    write_u16(0);
+    _ofs.put(0);
+}
+
+
+GIF_Writer::~GIF_Writer(void)
+{
+    flush_frames();
+    if (_frame_count != _num_frames)
+        std::cerr << "GIF file closed after " << _frame_count << " of "
+                  << _num_frames << " frames" << std::endl;
+    _ofs.put(0x3B); // trailer
+    _ofs.close();
+}
+
+
+void GIF_Writer::add_frame(const uint8_t* indices)
+{
+    // Find the bounding box of the pixels that changed since the previous
+    //   frame, so only that region has to be stored
+    GIF_Frame frame;
+    frame.x = 0;
+    frame.y = 0;
+    frame.w = _size;
+    frame.h = _size;
+    frame.transparent = -1;
+    if (_frame_count > 0)
+    {
+        size_t x0 = _size, y0 = _size, x1 = 0, y1 = 0;
+        for (size_t y = 0; y < _size; y++)
+        {
+            const uint8_t* cur_row = indices + y * _size;
+            const uint8_t* prev_row = &_previous[y * _size];
+            size_t x = 0;
+            while (x < _size && cur_row[x] == prev_row[x])
+                x++;
+            if (x == _size)
+                continue;
+            size_t last = _size - 1;
+            while (cur_row[last] == prev_row[last])
+                last--;
+            x0 = std::min(x0, x);
+            x1 = std::max(x1, last + 1);
+            y0 = std::min(y0, y);
+            y1 = y + 1;
+        }
+        // GIF frames can't be empty, repeat a single unchanged pixel
+        if (x1 == 0)
+        {
+            x0 = 0;
+            y0 = 0;
+            x1 = 1;
+            y1 = 1;
+        }
+        frame.x = x0;
+        frame.y = y0;
+        frame.w = x1 - x0;
+        frame.h = y1 - y0;
+    }
+
+    // Copy the region. Unchanged pixels become transparent if there is an
+    //   index the region doesn't use, which gives long runs for LZW
+    frame.indices.resize(frame.w * frame.h);
+    bool used[256] = {false};
+    for (size_t j = 0; j < frame.h; j++)
+    {
+        const uint8_t* src = indices + (frame.y + j) * _size + frame.x;
+        for (size_t i = 0; i < frame.w; i++)
+        {
+            frame.indices[j * frame.w + i] = src[i];
+            used[src[i]] = true;
+        }
+    }
+    if (_frame_count > 0)
+    {
+        for (int i = 0; i < 256 && frame.transparent < 0; i++)
+        {
+            if (!used[i])
+                frame.transparent = i;
+        }
+    }
+    if (frame.transparent >= 0)
+    {
+        for (size_t j = 0; j < frame.h; j++)
+        {
+            const uint8_t* prev = &_previous[(frame.y + j) * _size + frame.x];
+            uint8_t* dst = &frame.indices[j * frame.w];
+            for (size_t i = 0; i < frame.w; i++)
+            {
+                if (dst[i] == prev[i])
+                    dst[i] = (uint8_t)frame.transparent;
+            }
+        }
+    }
+    _previous.assign(indices, indices + _size * _size);
+
+    _pending.push_back(frame);
+    _frame_count++;
+    if (_pending.size() >= _batch_size)
+        flush_frames();
+}
+
+
+void GIF_Writer::flush_frames(void)
+{
+    // LZW code the pending frames in parallel, then write them in order
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < _pending.size(); i++)
+        threads.push_back(std::thread(encode_frame, &_pending[i]));
+    if (!_pending.empty())
+        encode_frame(&_pending[0]);
+    for (size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+    for (size_t i = 0; i < _pending.size(); i++)
+        write_frame(_pending[i]);
+    _pending.clear();
+}
+
+
+void GIF_Writer::write_frame(const GIF_Frame& frame)
+{
+    // Graphic control extension: keep the previous frame under this one
+    //   (disposal method 1), with an optional transparent index
+    _ofs.put(0x21);
+    _ofs.put((char)0xF9);
+    _ofs.put(4);
+    _ofs.put((char)((1 << 2) | (frame.transparent >= 0 ? 1 : 0)));
+    write_u16(_delay);
+    _ofs.put((char)(frame.transparent >= 0 ? frame.transparent : 0));
+    _ofs.put(0);
+    // Image descriptor without a local color table, then the image data
+    _ofs.put(0x2C);
+    write_u16((unsigned int)frame.x);
+    write_u16((unsigned int)frame.y);
+    write_u16((unsigned int)frame.w);
+    write_u16((unsigned int)frame.h);
+    _ofs.put(0);
+    _ofs.write((const char*)&frame.lzw[0], frame.lzw.size());
+}
+
+
+void GIF_Writer::write_u16(unsigned int value)
+{
+    // GIF stores 16-bit values in little endian byte order
+    _ofs.put((char)(value & 0xFF));
+    _ofs.put((char)((value >> 8) & 0xFF));
+}
@@ -0,0 +1,49 @@
+//  gif_writer.hpp
+//
+//  Header file for GIF writer object, which streams frames of palette
+//   indices to an animated GIF file, LZW coding several frames at once
+
+
+#ifndef GIF_WRITER_H
+#define GIF_WRITER_H
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <stdint.h>
+
+// Frame waiting to be LZW coded: the indices of the region that changed
+//   since the previous frame, and the coded result
+struct GIF_Frame
+{
+    size_t x, y, w, h;
+    int transparent; // palette index of unchanged pixels, or -1
+    std::vector<uint8_t> indices;
+    std::vector<uint8_t> lzw;
+};
+
+class GIF_Writer
+{
+    public:
+        GIF_Writer(std::string filename,
+                   size_t size,
+                   unsigned int num_frames,
+                   unsigned int fps,
+                   const std::vector<unsigned char>& palette);
+        ~GIF_Writer(void);
+        void add_frame(const uint8_t* indices);
+    private:
+        void flush_frames(void);
+        void write_frame(const GIF_Frame& frame);
+        void write_u16(unsigned int value);
+        std::ofstream _ofs;
+        size_t _size;
+        unsigned int _num_frames;
+        unsigned int _delay;
+        unsigned int _frame_count;
+        unsigned int _batch_size;
+        std::vector<uint8_t> _previous;
+        std::vector<GIF_Frame> _pending;
+};
+
+#endif // GIF_WRITER_H
@@ -0,0 +1,75 @@
+//  host_render.cpp
+//
+//  Source code for host rendering functions
+
+
+#include <cmath>
+#include <algorithm>
+#include <thread>
+#include "host_render.hpp"
+
+
+static uint8_t host_depth(double z_re, double z_im, double c_re,
+                          double c_im, const Attracting_Cycle& cycle)
+{
+    // Same escape test as julia_depth_cycle, with the magnitude as a float.
+    //   Neither side contracts into fma (see the Makefile and kernel.cl),
+    //   so split frames have the same depths on both
+    double radius2 = cycle.radius * cycle.radius;
+    unsigned int depth = 255;
+    while ((float)std::sqrt(z_re * z_re + z_im * z_im) < 1000 && depth >= 1)
+    {
+        double d_re = z_re - cycle.re;
+        double d_im = z_im - cycle.im;
+        if (d_re * d_re + d_im * d_im < radius2)
+            return 0;
+        double re = z_re * z_re - z_im * z_im + c_re;
+        z_im = z_re * z_im + z_im * z_re + c_im;
+        z_re = re;
+        depth--;
+    }
+    return (uint8_t)depth;
+}
+
+
+static void render_rows(const std::vector<float>* spaced_re,
+                        const std::vector<float>* spaced_im,
+                        size_t first_row, size_t last_row, size_t step,
+                        float c_re, float c_im,
+                        const Attracting_Cycle* cycle, uint8_t* depths,
+                        size_t row_offset)
+{
+    // Every step-th row from first_row, into depths starting at the row
+    //   row_offset
+    size_t size = spaced_re->size();
+    for (size_t y = first_row; y < last_row; y += step)
+    {
+        uint8_t* row = depths + (y - row_offset) * size;
+        for (size_t x = 0; x < size; x++)
+            row[x] = host_depth((*spaced_re)[x], (*spaced_im)[y], c_re, c_im,
+                                *cycle);
+    }
+}
+
+
+void host_render_depths(const std::vector<float>& spaced_re,
+                        const std::vector<float>& spaced_im,
+                        size_t first_row, size_t last_row,
+                        float c_re, float c_im,
+                        const Attracting_Cycle& cycle, uint8_t* depths)
+{
+    // Interleave the rows among the threads, so each gets rows from every
+    //   part of the range and about the same work
+    size_t count = std::max(1u, std::thread::hardware_concurrency());
+    count = std::min(count, last_row - first_row);
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < count; i++)
+        threads.push_back(std::thread(render_rows, &spaced_re, &spaced_im,
+                                      first_row + i, last_row, count, c_re,
+                                      c_im, &cycle, depths, first_row));
+    if (count > 0)
+        render_rows(&spaced_re, &spaced_im, first_row, last_row, count,
+                    c_re, c_im, &cycle, depths, first_row);
+    for (size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+}
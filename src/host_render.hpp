@@ -0,0 +1,26 @@
+//  host_render.hpp
+//
+//  Header file for rendering julia set depths on the host's CPU cores,
+//   which take a share of the rows of each frame while the OpenCL device
+//   renders the rest
+
+
+#ifndef HOST_RENDER_H
+#define HOST_RENDER_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "attracting_cycle.hpp"
+
+// Depths of rows first_row to last_row - 1 of a frame on the grid of
+//   spaced_re and spaced_im, in the double precision arithmetic of
+//   julia_depth_cycle, one byte per pixel. The rows are shared among the
+//   host's hardware threads
+void host_render_depths(const std::vector<float>& spaced_re,
+                        const std::vector<float>& spaced_im,
+                        size_t first_row, size_t last_row,
+                        float c_re, float c_im,
+                        const Attracting_Cycle& cycle, uint8_t* depths);
+
+#endif // HOST_RENDER_H
@@ -6,6 +6,8 @@
 //  Source code for julia set object functions
 
 
+#include <cfloat>
+#include <cmath>
 #include "julia_set.hpp"
 
 Julia_Set::Julia_Set(size_t size, 
@@ -14,6 +16,7 @@ Julia_Set::Julia_Set(size_t size,
 {
     // Initialize a few object variables
     _size = size;
+    _context = context;
     _origin[0] = 0;
     _origin[1] = 0;
     _origin[2] = 0;
@@ -21,7 +24,16 @@ Julia_Set::Julia_Set(size_t size,
     _region[1] = _size;
     _region[2] = 1;
     // Allocated memory for resulting image after OpenCL kernel execution
-    _result = new uint8_t[_size * _size * 4];
+    _result.resize(_size * _size * 4);
+    _symmetric = false;
+    _grouped = false;
+    _variant = KERNEL_DOUBLE;
+    _launch_width = _size;
+    _launch_height = _size;
+    _local_width = 0;
+    _local_height = 0;
+    _resume_passes = RESUME_PASSES;
+    _host_rows = 0;
     // Create a blank OpenCL image
     _image = cl::Image2D(*context,
                          CL_MEM_READ_WRITE,
@@ -49,16 +61,45 @@ void Julia_Set::fill_white(cl::CommandQueue* queue)
 
 
 void Julia_Set::create_kernel(cl::Program* program,
-                              std::string function_name,
+                              Kernel_Variant variant,
                               cl::Buffer* buffer_re,
                               cl::Buffer* buffer_im,
                               cl::Buffer* cmap_buf,
                               unsigned int cmap_size,
                               float c_re,
-                              float c_im)
+                              float c_im,
+                              const Attracting_Cycle& cycle,
+                              Variant_Buffers* shared)
 {   
-    // Set arguments for kernel specific to this julia set 
-    _render_kernel = cl::Kernel(*program, function_name.c_str());
+    // Set arguments for kernel specific to this julia set, including the
+    //   attracting cycle that lets interior pixels stop early. The mixed,
+    //   sorted and resumable variants also need the buffers all frames
+    //   share
+    _buffer_re = buffer_re;
+    _buffer_im = buffer_im;
+    _cmap_buf = cmap_buf;
+    _cmap_size = cmap_size;
+    _c_re = c_re;
+    _c_im = c_im;
+    _cycle = cycle;
+    _variant = variant;
+    _shared = shared;
+    if (variant == KERNEL_FLOAT_FLOAT)
+        _render_kernel = cl::Kernel(*program, "render_image_ff");
+    else if (variant == KERNEL_MIXED)
+        _render_kernel = cl::Kernel(*program, "render_image_mixed");
+    else if (variant == KERNEL_FIXED)
+        _render_kernel = cl::Kernel(*program, "render_image_fixed");
+    else if (variant == KERNEL_UNROLLED)
+        _render_kernel = cl::Kernel(*program, "render_image_unrolled");
+    else if (variant == KERNEL_PERSISTENT)
+        _render_kernel = cl::Kernel(*program, "render_image_persistent");
+    else if (variant == KERNEL_SORTED)
+        _render_kernel = cl::Kernel(*program, "render_image_sorted");
+    else if (variant == KERNEL_RESUMABLE)
+        _render_kernel = cl::Kernel(*program, "render_image_resumable");
+    else
+        _render_kernel = cl::Kernel(*program, "render_image");
     _render_kernel.setArg(0, _image);
     _render_kernel.setArg(1, *buffer_re);
     _render_kernel.setArg(2, *buffer_im);
@@ -66,20 +107,518 @@ void Julia_Set::create_kernel(cl::Program* program,
     _render_kernel.setArg(4, cmap_size);
     _render_kernel.setArg(5, c_re);
     _render_kernel.setArg(6, c_im);
+    if (variant == KERNEL_FLOAT_FLOAT || variant == KERNEL_MIXED)
+    {
+        // The float kernels test their floats against a float cycle point,
+        //   shrink the disk by more than the rounding of both
+        double slack = 8.0 * FLT_EPSILON * (fabs(cycle.re) + fabs(cycle.im) +
+                                            cycle.radius);
+        double radius = std::max(0.0, cycle.radius - slack);
+        _render_kernel.setArg(7, (cl_float)cycle.re);
+        _render_kernel.setArg(8, (cl_float)cycle.im);
+        _render_kernel.setArg(9, (cl_float)(radius * (1.0 - FLT_EPSILON)));
+    }
+    else if (variant == KERNEL_FIXED)
+    {
+        // Cycle point with 52 fraction bits, and the squared radius with
+        //   40, shrunk by more than their rounding
+        double radius = std::max(0.0, cycle.radius * (1.0 - 1e-6) - 1e-12);
+        _render_kernel.setArg(7, (cl_long)ldexp(cycle.re, 52));
+        _render_kernel.setArg(8, (cl_long)ldexp(cycle.im, 52));
+        _render_kernel.setArg(9, (cl_long)ldexp(radius * radius, 40));
+    }
+    else
+    {
+        _render_kernel.setArg(7, (cl_double)cycle.re);
+        _render_kernel.setArg(8, (cl_double)cycle.im);
+        _render_kernel.setArg(9, (cl_double)cycle.radius);
+    }
+    if (variant == KERNEL_MIXED)
+    {
+        _render_kernel.setArg(10, shared->flagged);
+        _render_kernel.setArg(11, shared->flagged_count);
+        _refine_kernel = cl::Kernel(*program, "refine_flagged");
+        _refine_kernel.setArg(0, _image);
+        _refine_kernel.setArg(1, *buffer_re);
+        _refine_kernel.setArg(2, *buffer_im);
+        _refine_kernel.setArg(3, *cmap_buf);
+        _refine_kernel.setArg(4, cmap_size);
+        _refine_kernel.setArg(5, c_re);
+        _refine_kernel.setArg(6, c_im);
+        _refine_kernel.setArg(7, (cl_double)cycle.re);
+        _refine_kernel.setArg(8, (cl_double)cycle.im);
+        _refine_kernel.setArg(9, (cl_double)cycle.radius);
+        _refine_kernel.setArg(10, shared->flagged);
+        _refine_kernel.setArg(11, shared->flagged_count);
+    }
+    if (variant == KERNEL_PERSISTENT)
+    {
+        // A few work groups per compute unit of the context's device, which
+        //   take tiles until a counter of their own runs out
+        _tile_counter = cl::Buffer(*_context, CL_MEM_READ_WRITE,
+                                   sizeof(cl_uint), NULL, &_err);
+        if (_err != CL_SUCCESS)
+            std::cerr << "Could not create OpenCL tile counter" << std::endl;
+        _render_kernel.setArg(10, _tile_counter);
+        std::vector<cl::Device> devices =
+            _context->getInfo<CL_CONTEXT_DEVICES>();
+        cl_uint units = devices[0].getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>();
+        _launch_width = units * PERSISTENT_GROUPS_PER_UNIT *
+                        PERSISTENT_GROUP_SIZE;
+        _launch_height = 1;
+        _local_width = PERSISTENT_GROUP_SIZE;
+        _local_height = 1;
+        return;
+    }
+    if (variant == KERNEL_SORTED)
+    {
+        // One work item per pixel in the order the sort passes give
+        _render_kernel.setArg(10, shared->order);
+        _render_kernel.setArg(11, shared->depths);
+        _bin_kernel = cl::Kernel(*program, "bin_depths");
+        _bin_kernel.setArg(0, shared->depths);
+        _bin_kernel.setArg(1, shared->bins);
+        _prefix_kernel = cl::Kernel(*program, "prefix_bins");
+        _prefix_kernel.setArg(0, shared->bins);
+        _order_kernel = cl::Kernel(*program, "order_pixels");
+        _order_kernel.setArg(0, shared->depths);
+        _order_kernel.setArg(1, shared->bins);
+        _order_kernel.setArg(2, shared->order);
+        _launch_width = _size * _size;
+        _launch_height = 1;
+        return;
+    }
+    if (variant == KERNEL_RESUMABLE)
+    {
+        // The first pass fills the first list, then each pass continues
+        //   the pixels of one list into the other
+        _render_kernel.setArg(10, shared->states[0]);
+        _render_kernel.setArg(11, shared->state_counts[0]);
+        _render_kernel.setArg(12, (cl_uint)0);
+        for (unsigned int k = 0; k < 2; k++)
+        {
+            _resume_kernels[k] = cl::Kernel(*program, "resume_pixels");
+            _resume_kernels[k].setArg(0, _image);
+            _resume_kernels[k].setArg(1, *cmap_buf);
+            _resume_kernels[k].setArg(2, cmap_size);
+            _resume_kernels[k].setArg(3, c_re);
+            _resume_kernels[k].setArg(4, c_im);
+            _resume_kernels[k].setArg(5, (cl_double)cycle.re);
+            _resume_kernels[k].setArg(6, (cl_double)cycle.im);
+            _resume_kernels[k].setArg(7, (cl_double)cycle.radius);
+            _resume_kernels[k].setArg(8, shared->states[k]);
+            _resume_kernels[k].setArg(9, shared->state_counts[k]);
+            _resume_kernels[k].setArg(10, shared->states[1 - k]);
+            _resume_kernels[k].setArg(11, shared->state_counts[1 - k]);
+            _resume_kernels[k].setArg(12, (cl_uint)0);
+        }
+        _launch_width = _size;
+        return;
+    }
+    // One pixel per work item until set_launch_shape says otherwise
+    _render_kernel.setArg(variant == KERNEL_MIXED ? 12 : 10, (cl_uint)1);
+    _launch_width = _size / (variant == KERNEL_UNROLLED ? UNROLLED_LANES : 1);
+}
+
+
+void Julia_Set::create_depth_kernel(cl::Program* program,
+                                    cl::Buffer* buffer_re,
+                                    cl::Buffer* buffer_im,
+                                    float c_re,
+                                    float c_im,
+                                    const Attracting_Cycle& cycle)
+{
+    // Render one palette index (depth) per pixel into a buffer instead of
+    //   colored pixels into the image. Kernels read it back on the device
+    //   too (cycle_colors, mirror_colors), so it can't be write only
+    _depth = cl::Buffer(*_context, CL_MEM_READ_WRITE, _size * _size, NULL,
+                        &_err);
+    if (_err != CL_SUCCESS)
+        std::cerr << "Could not create OpenCL depth buffer" << std::endl;
+    _render_kernel = cl::Kernel(*program, "render_depth");
+    _render_kernel.setArg(0, _depth);
+    _render_kernel.setArg(1, *buffer_re);
+    _render_kernel.setArg(2, *buffer_im);
+    _render_kernel.setArg(3, c_re);
+    _render_kernel.setArg(4, c_im);
+    _render_kernel.setArg(5, (cl_double)cycle.re);
+    _render_kernel.setArg(6, (cl_double)cycle.im);
+    _render_kernel.setArg(7, (cl_double)cycle.radius);
+    _render_kernel.setArg(8, (cl_uint)_size);
+}
+
+
+void Julia_Set::create_vector_kernel(cl::Program* program,
+                                     Julia_Set* group,
+                                     unsigned int count,
+                                     cl::Buffer* buffer_re,
+                                     cl::Buffer* buffer_im,
+                                     cl::Buffer* cmap_buf,
+                                     unsigned int cmap_size,
+                                     const float* c_re,
+                                     const float* c_im)
+{
+    // Render the count (at most 4) consecutive julia sets of group, which
+    //   starts with this one, in one kernel with a vector lane per frame.
+    //   Lanes past count repeat the last frame
+    _render_kernel = cl::Kernel(*program, "render_images4");
+    cl_float4 c_re4;
+    cl_float4 c_im4;
+    for (unsigned int k = 0; k < 4; k++)
+    {
+        unsigned int j = std::min(k, count - 1);
+        _render_kernel.setArg(k, group[j]._image);
+        c_re4.s[k] = c_re[j];
+        c_im4.s[k] = c_im[j];
+        // The other frames of the group are rendered by this kernel
+        if (j > 0)
+            group[j]._grouped = true;
+    }
+    _render_kernel.setArg(4, *buffer_re);
+    _render_kernel.setArg(5, *buffer_im);
+    _render_kernel.setArg(6, *cmap_buf);
+    _render_kernel.setArg(7, cmap_size);
+    _render_kernel.setArg(8, c_re4);
+    _render_kernel.setArg(9, c_im4);
+}
+
+
+void Julia_Set::create_perturbed_kernel(cl::Program* program,
+                                        const std::vector<double>& reference,
+                                        const std::vector<double>& critical,
+                                        cl::Buffer* cmap_buf,
+                                        unsigned int cmap_size,
+                                        double pixel_size)
+{
+    // Render a deep zoom around the first point of the reference orbit.
+    //   Both orbits are interleaved re, im pairs, copied to the device as
+    //   one Complex per point
+    _reference = cl::Buffer(*_context,
+                            CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                            sizeof(cl_double) * reference.size(),
+                            (void*)&reference[0],
+                            &_err);
+    if (_err != CL_SUCCESS)
+        std::cerr << "Could not create OpenCL reference orbit buffer"
+                  << std::endl;
+    _critical = cl::Buffer(*_context,
+                           CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                           sizeof(cl_double) * critical.size(),
+                           (void*)&critical[0],
+                           &_err);
+    if (_err != CL_SUCCESS)
+        std::cerr << "Could not create OpenCL critical orbit buffer"
+                  << std::endl;
+    _variant = KERNEL_PERTURBED;
+    _render_kernel = cl::Kernel(*program, "render_perturbed");
+    _render_kernel.setArg(0, _image);
+    _render_kernel.setArg(1, _reference);
+    _render_kernel.setArg(2, (cl_uint)(reference.size() / 2));
+    _render_kernel.setArg(3, _critical);
+    _render_kernel.setArg(4, (cl_uint)(critical.size() / 2));
+    _render_kernel.setArg(5, *cmap_buf);
+    _render_kernel.setArg(6, cmap_size);
+    _render_kernel.setArg(7, (cl_double)pixel_size);
+}
+
+
+void Julia_Set::set_launch_shape(size_t local_width, size_t local_height,
+                                 unsigned int strip)
+{
+    // Launch work groups of local_width by local_height items (0 lets the
+    //   driver choose), each computing strip pixels of a row, which must
+    //   divide the size. Only the kernels of create_kernel compute strips,
+    //   and persistent, sorted and resumable kernels keep their own launch
+    if (_variant == KERNEL_PERSISTENT || _variant == KERNEL_SORTED ||
+        _variant == KERNEL_RESUMABLE)
+        return;
+    _local_width = local_width;
+    _local_height = local_height;
+    if (_variant == KERNEL_PERTURBED)
+        return;
+    _render_kernel.setArg(_variant == KERNEL_MIXED ? 12 : 10, (cl_uint)strip);
+    if (_variant == KERNEL_UNROLLED)
+        strip *= UNROLLED_LANES;
+    _launch_width = _size / strip;
+}
+
+
+bool Julia_Set::use_symmetry(cl::Program* program, bool point,
+                             bool conjugate)
+{
+    // Replace the kernel set by create_kernel with depths for the rows up
+    //   to the middle one (or the top left quarter when both symmetries
+    //   hold), and a kernel that colors every pixel from its mirror pixel.
+    //   The depth and mirror kernels compute in double precision, with
+    //   the full iteration limit, so resumable kernels limited to half of
+    //   it or less are left to run their own passes
+    if ((!point && !conjugate) ||
+        (_variant != KERNEL_DOUBLE && _variant != KERNEL_UNROLLED &&
+         _variant != KERNEL_PERSISTENT && _variant != KERNEL_SORTED &&
+         _variant != KERNEL_RESUMABLE) ||
+        (_variant == KERNEL_RESUMABLE && _resume_passes <= RESUME_PASSES / 2))
+        return false;
+    create_depth_kernel(program, _buffer_re, _buffer_im, _c_re, _c_im,
+                        _cycle);
+    _symmetric = true;
+    // Work groups of the persistent kernel don't fit the depth kernel
+    if (_variant == KERNEL_PERSISTENT)
+    {
+        _local_width = 0;
+        _local_height = 0;
+    }
+    _launch_width = (point && conjugate) ? _size / 2 + 1 : _size;
+    _launch_height = _size / 2 + 1;
+    // mirror_colors reads the depths the depth kernel wrote, which is why
+    //   create_depth_kernel makes the buffer read-write
+    _mirror_kernel = cl::Kernel(*program, "mirror_colors");
+    _mirror_kernel.setArg(0, _image);
+    _mirror_kernel.setArg(1, _depth);
+    _mirror_kernel.setArg(2, *_buffer_re);
+    _mirror_kernel.setArg(3, *_buffer_im);
+    _mirror_kernel.setArg(4, *_cmap_buf);
+    _mirror_kernel.setArg(5, _cmap_size);
+    _mirror_kernel.setArg(6, _c_re);
+    _mirror_kernel.setArg(7, _c_im);
+    _mirror_kernel.setArg(8, (cl_double)_cycle.re);
+    _mirror_kernel.setArg(9, (cl_double)_cycle.im);
+    _mirror_kernel.setArg(10, (cl_double)_cycle.radius);
+    _mirror_kernel.setArg(11, (cl_int)(point ? 1 : 0));
+    _mirror_kernel.setArg(12, (cl_int)(conjugate ? 1 : 0));
+    return true;
 }
 
 
-void Julia_Set::queue_kernel(cl::CommandQueue* queue)
+unsigned int Julia_Set::set_iteration_limit(unsigned int limit)
 {
-    // Add julia set kernel to queue to start computation
-    cl_int err = queue->enqueueNDRangeKernel(_render_kernel,
-                                             cl::NullRange,
-                                             cl::NDRange(_size, _size),
-                                             cl::NullRange,
-                                             NULL,
-                                             NULL);
+    // Stop iterating the pixels of a resumable kernel after limit
+    //   iterations, rounded up to the end of a pass, and give the ones
+    //   still unresolved depth 0. Returns the limit the frame renders with
+    const unsigned int full = RESUME_PASSES * RESUME_STEPS - 1;
+    if (_variant != KERNEL_RESUMABLE || _symmetric)
+        return full;
+    _resume_passes = std::min(RESUME_PASSES, limit / RESUME_STEPS + 1);
+    cl_uint stop = (RESUME_PASSES - _resume_passes) * RESUME_STEPS;
+    _render_kernel.setArg(12, stop);
+    for (unsigned int k = 0; k < 2; k++)
+        _resume_kernels[k].setArg(12, stop);
+    return full - stop;
+}
+
+
+unsigned int Julia_Set::iteration_limit(void)
+{
+    // Limit the frame renders with: the passes of a resumable kernel, or
+    //   the full limit for other kernels and symmetric julia sets
+    if (_variant != KERNEL_RESUMABLE || _symmetric)
+        return RESUME_PASSES * RESUME_STEPS - 1;
+    return _resume_passes * RESUME_STEPS - 1;
+}
+
+
+void Julia_Set::set_host_rows(size_t rows)
+{
+    // Leave the last rows of the frame to render_host_rows: the launch and
+    //   the read back only cover the rows above them. Only kernels that
+    //   compute the pixels of their launch rows can be cut short like
+    //   this, not the persistent, sorted and resumable ones or symmetric
+    //   julia sets
+    _host_rows = rows;
+    _launch_height = _size - rows;
+    _region[1] = _size - rows;
+}
+
+
+void Julia_Set::render_host_rows(const std::vector<float>& spaced_re,
+                                 const std::vector<float>& spaced_im,
+                                 const cl_uint4* cmap)
+{
+    // Render the rows set_host_rows left out on the host, colored like
+    //   depth_color_index does, straight into the resulting image
+    size_t first_row = _size - _host_rows;
+    std::vector<uint8_t> depths(_host_rows * _size);
+    if (depths.empty())
+        return;
+    host_render_depths(spaced_re, spaced_im, first_row, _size, _c_re, _c_im,
+                       _cycle, &depths[0]);
+    uint8_t* pixel = &_result[0] + first_row * _size * 4;
+    for (size_t i = 0; i < depths.size(); i++, pixel += 4)
+    {
+        unsigned int index = (float)depths[i] / 255.0f * _cmap_size;
+        const cl_uint4& color = cmap[std::min(index, _cmap_size - 1)];
+        for (unsigned int k = 0; k < 4; k++)
+            pixel[k] = (uint8_t)color.s[k];
+    }
+}
+
+
+void Julia_Set::create_cycle_kernel(cl::Program* program,
+                                    cl::Buffer* depths,
+                                    cl::Buffer* cmap_buf,
+                                    unsigned int cmap_size,
+                                    unsigned int phase)
+{
+    // Color a depth field rendered by another julia set's depth kernel,
+    //   with the colormap rotated by phase entries
+    _render_kernel = cl::Kernel(*program, "cycle_colors");
+    _render_kernel.setArg(0, _image);
+    _render_kernel.setArg(1, *depths);
+    _render_kernel.setArg(2, *cmap_buf);
+    _render_kernel.setArg(3, cmap_size);
+    _render_kernel.setArg(4, phase);
+}
+
+
+void Julia_Set::create_coherent_kernel(cl::Program* program,
+                                       cl::Buffer* buffer_re,
+                                       cl::Buffer* buffer_im,
+                                       cl::Buffer* depths,
+                                       cl::Buffer* certified,
+                                       cl::Buffer* cmap_buf,
+                                       unsigned int cmap_size,
+                                       float c_re,
+                                       float c_im,
+                                       double radius,
+                                       bool key_frame)
+{
+    // A key frame fills the depths and certified buffers for every c
+    //   within radius of its own, the other frames of its group read them
+    _render_kernel = cl::Kernel(*program, "render_coherent");
+    _render_kernel.setArg(0, _image);
+    _render_kernel.setArg(1, *depths);
+    _render_kernel.setArg(2, *certified);
+    _render_kernel.setArg(3, *buffer_re);
+    _render_kernel.setArg(4, *buffer_im);
+    _render_kernel.setArg(5, *cmap_buf);
+    _render_kernel.setArg(6, cmap_size);
+    _render_kernel.setArg(7, c_re);
+    _render_kernel.setArg(8, c_im);
+    _render_kernel.setArg(9, (cl_double)radius);
+    _render_kernel.setArg(10, (cl_int)(key_frame ? 1 : 0));
+}
+
+
+void Julia_Set::queue_kernel(cl::CommandQueue* queue, cl::Event* event)
+{
+    // Add julia set kernel to queue to start computation, unless another
+    //   julia set's kernel renders this one. The event, if given, is the
+    //   one of the main render kernel
+    if (_grouped)
+        return;
+    cl_int err;
+    // Work groups that don't divide the launch (like the half frames of
+    //   symmetric julia sets) are left to the driver
+    cl::NDRange local = cl::NullRange;
+    if (_local_width > 0 && _launch_width % _local_width == 0 &&
+        _launch_height % _local_height == 0)
+        local = cl::NDRange(_local_width, _local_height);
+    if (_variant == KERNEL_MIXED)
+    {
+        // Start with an empty list of pixels to refine
+        cl_uint zero = 0;
+        err = queue->enqueueFillBuffer(_shared->flagged_count, zero, 0,
+                                       sizeof(cl_uint));
+        if (err != CL_SUCCESS)
+            std::cerr << "Could not clear flagged pixel count" << std::endl;
+    }
+    else if (_variant == KERNEL_PERSISTENT && !_symmetric)
+    {
+        // Hand out tiles from the first one
+        cl_uint zero = 0;
+        err = queue->enqueueFillBuffer(_tile_counter, zero, 0,
+                                       sizeof(cl_uint));
+        if (err != CL_SUCCESS)
+            std::cerr << "Could not clear tile counter" << std::endl;
+    }
+    else if (_variant == KERNEL_SORTED && !_symmetric)
+    {
+        // Order the pixels by the depths of the frame before
+        cl_uint zero = 0;
+        err = queue->enqueueFillBuffer(_shared->bins, zero, 0,
+                                       sizeof(cl_uint) * 256);
+        if (err == CL_SUCCESS)
+            err = queue->enqueueNDRangeKernel(_bin_kernel,
+                                              cl::NullRange,
+                                              cl::NDRange(_size * _size),
+                                              cl::NullRange,
+                                              NULL,
+                                              NULL);
+        if (err == CL_SUCCESS)
+            err = queue->enqueueTask(_prefix_kernel, NULL, NULL);
+        if (err == CL_SUCCESS)
+            err = queue->enqueueNDRangeKernel(_order_kernel,
+                                              cl::NullRange,
+                                              cl::NDRange(_size * _size),
+                                              cl::NullRange,
+                                              NULL,
+                                              NULL);
+        if (err != CL_SUCCESS)
+            std::cerr << "Could not add pixel sort to queue" << std::endl;
+    }
+    else if (_variant == KERNEL_RESUMABLE && !_symmetric)
+    {
+        // Start with an empty list of unresolved pixels
+        cl_uint zero = 0;
+        err = queue->enqueueFillBuffer(_shared->state_counts[0], zero, 0,
+                                       sizeof(cl_uint));
+        if (err != CL_SUCCESS)
+            std::cerr << "Could not clear unresolved pixel count"
+                      << std::endl;
+    }
+    err = queue->enqueueNDRangeKernel(_render_kernel,
+                                      cl::NullRange,
+                                      cl::NDRange(_launch_width,
+                                                  _launch_height),
+                                      local,
+                                      NULL,
+                                      event);
     if (err != CL_SUCCESS)
         std::cerr << "Could not add kernel to queue" << std::endl;
+    // Then fill in the whole image from the computed part
+    if (_symmetric)
+    {
+        err = queue->enqueueNDRangeKernel(_mirror_kernel,
+                                          cl::NullRange,
+                                          cl::NDRange(_size, _size),
+                                          cl::NullRange,
+                                          NULL,
+                                          NULL);
+        if (err != CL_SUCCESS)
+            std::cerr << "Could not add mirror kernel to queue" << std::endl;
+    }
+    // Or recompute the pixels the first pass flagged
+    if (_variant == KERNEL_MIXED)
+    {
+        err = queue->enqueueNDRangeKernel(_refine_kernel,
+                                          cl::NullRange,
+                                          cl::NDRange(_size * _size),
+                                          cl::NullRange,
+                                          NULL,
+                                          NULL);
+        if (err != CL_SUCCESS)
+            std::cerr << "Could not add refine kernel to queue" << std::endl;
+    }
+    // Or continue the unresolved pixels, a pass at a time
+    if (_variant == KERNEL_RESUMABLE && !_symmetric)
+    {
+        for (unsigned int pass = 1; pass < _resume_passes; pass++)
+        {
+            unsigned int k = (pass - 1) % 2;
+            cl_uint zero = 0;
+            err = queue->enqueueFillBuffer(_shared->state_counts[1 - k],
+                                           zero, 0, sizeof(cl_uint));
+            if (err == CL_SUCCESS)
+                err = queue->enqueueNDRangeKernel(_resume_kernels[k],
+                                                  cl::NullRange,
+                                                  cl::NDRange(_size * _size),
+                                                  cl::NullRange,
+                                                  NULL,
+                                                  NULL);
+            if (err != CL_SUCCESS)
+                std::cerr << "Could not add resume kernel to queue"
+                          << std::endl;
+        }
+    }
 }
 
 
@@ -88,12 +627,25 @@ void Julia_Set::read_image_to_host(cl::CommandQueue* queue)
     // Read OpenCL image from device memory to host memory, 
     //   into the array allocated in the constructor
     cl_int err = queue->enqueueReadImage(_image, CL_TRUE, _origin, _region,
-                                         0, 0, _result, NULL, NULL);
+                                         0, 0, &_result[0], NULL, NULL);
     if (err != CL_SUCCESS)
         std::cerr << "Could not read image to host" << std::endl;
 }
 
 
+void Julia_Set::read_depth_to_host(cl::CommandQueue* queue)
+{
+    // Read depth buffer from device memory to host memory, into an array
+    //   allocated on first use
+    if (_depth_result.empty())
+        _depth_result.resize(_size * _size);
+    cl_int err = queue->enqueueReadBuffer(_depth, CL_TRUE, 0, _size * _size,
+                                          &_depth_result[0], NULL, NULL);
+    if (err != CL_SUCCESS)
+        std::cerr << "Could not read depth buffer to host" << std::endl;
+}
+
+
 void Julia_Set::export_to_png(std::string filename)
 {
     // Use the lodepng library to encode and export the resulting julia
@@ -127,3 +679,60 @@ void Julia_Set::export_to_ppm(std::string filename)
     }
     ofs.close();
 }
+
+
+bool Julia_Set::export_to_qoi(std::string filename, bool verify)
+{
+    // Encode the image to a QOI file, which is about as fast as writing a
+    //   PPM file but much smaller thanks to its runs over flat regions
+    std::vector<unsigned char> qoi;
+    if (!qoi_encode(&_result[0], _size, _size, 4, &qoi))
+    {
+        std::cerr << "Image encoding error: invalid QOI image size"
+                  << std::endl;
+        return false;
+    }
+    std::ofstream ofs;
+    ofs.open(filename.c_str(), std::ios::binary);
+    ofs.write((const char*)&qoi[0], qoi.size());
+    ofs.close();
+    if (!verify)
+        return true;
+
+    // Decode the file again and compare it with the image byte for byte
+    std::vector<unsigned char> decoded;
+    unsigned int width, height, channels;
+    if (!qoi_decode(qoi, &width, &height, &channels, &decoded) ||
+        width != _size || height != _size || channels != 4 ||
+        decoded.size() != _size * _size * 4 ||
+        !std::equal(decoded.begin(), decoded.end(), _result.begin()))
+    {
+        std::cerr << "QOI round trip error: " << filename
+                  << " does not decode to the rendered image" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+bool Julia_Set::export_to_apng(APNG_Writer* apng)
+{
+    // Append the image as the next frame of an animated PNG file, which
+    //   only stores the region that changed since the previous frame
+    return apng->add_frame(&_result[0]);
+}
+
+
+void Julia_Set::export_to_gif(GIF_Writer* gif)
+{
+    // Append the depths as the next frame of an animated GIF file, using
+    //   them directly as indices into the colormap palette
+    gif->add_frame(&_depth_result[0]);
+}
+
+
+void Julia_Set::export_to_archive(Field_Archive_Writer* archive)
+{
+    // Append the depths as the next frame of an iteration field archive
+    archive->add_frame(&_depth_result[0]);
+}
@@ -12,14 +12,82 @@
 
 #include <iostream>
 #include <fstream>
+#include <vector>
 #include <algorithm>
 #include "lodepng.h"
+#include "apng_writer.hpp"
+#include "gif_writer.hpp"
+#include "qoi.hpp"
+#include "field_archive.hpp"
+#include "attracting_cycle.hpp"
+#include "host_render.hpp"
 #ifdef __APPLE__
 #include <OpenCL/cl.hpp>
 #else
 #include <CL/cl.hpp>
 #endif
 
+// Arithmetic of the render_image kernel variants. The double ones (and
+//   mixed, which certifies its float pixels) compute the same depths from
+//   the same arguments; float-float and fixed point have fewer bits, so
+//   their depths can differ wherever pixels are closer than that
+enum Kernel_Variant
+{
+    KERNEL_DOUBLE,      // render_image
+    KERNEL_FLOAT_FLOAT, // render_image_ff, pairs of floats (about 48 bits)
+    KERNEL_PERTURBED,   // render_perturbed, offsets from a reference orbit
+    KERNEL_MIXED,       // render_image_mixed in float, then refine_flagged
+                        //   in double for the pixels it couldn't certify
+    KERNEL_FIXED,       // render_image_fixed, 64-bit integers (52 fraction
+                        //   bits)
+    KERNEL_UNROLLED,    // render_image_unrolled in double, UNROLLED_LANES
+                        //   pixels per vector with batched escape tests
+    KERNEL_PERSISTENT,  // render_image_persistent in double, work groups
+                        //   taking tiles from a counter
+    KERNEL_SORTED,      // render_image_sorted in double, pixels ordered by
+                        //   the depths of the frame queued before
+    KERNEL_RESUMABLE,   // render_image_resumable in double, then passes of
+                        //   resume_pixels over the unresolved pixels
+    KERNEL_VARIANTS     // number of variants
+};
+
+// Buffers the frames of a variant share, which the in-order queue lets
+//   them use in turn
+struct Variant_Buffers
+{
+    // Mixed: pixels left to refine in double precision, and their count
+    cl::Buffer flagged;
+    cl::Buffer flagged_count;
+    // Sorted: depths of the frame queued before (all 0 at first), its
+    //   pixels ordered by them and the 256 depth bins that give the order
+    cl::Buffer depths;
+    cl::Buffer order;
+    cl::Buffer bins;
+    // Resumable: two lists of unresolved pixels with their counts, each
+    //   pass reading one and appending to the other
+    cl::Buffer states[2];
+    cl::Buffer state_counts[2];
+};
+
+// Bytes per pixel of a resumable state list (Resume_State in kernel.cl),
+//   iterations per pass (its RESUME_STEPS) and the passes that take every
+//   pixel to its depth
+static const size_t RESUME_STATE_SIZE = 32;
+static const unsigned int RESUME_STEPS = 32;
+static const unsigned int RESUME_PASSES = 8;
+
+// Work groups per compute unit render_image_persistent launches, and
+//   their size (its PERSISTENT_TILE squared)
+static const unsigned int PERSISTENT_GROUPS_PER_UNIT = 4;
+static const size_t PERSISTENT_GROUP_SIZE = 64;
+
+// Pixels render_image_unrolled computes together, so a strip of n is
+//   n * UNROLLED_LANES pixels and only sizes it divides can use it
+static const unsigned int UNROLLED_LANES = 4;
+
+// Depths a pixel can have, one byte each
+static const unsigned int DEPTH_LEVELS = 256;
+
 class Julia_Set
 {
     public:
@@ -29,32 +97,111 @@ class Julia_Set
                   cl::Context* context);
         void fill_white(cl::CommandQueue* queue);
         void create_kernel(cl::Program* program, 
-                           std::string function_name,
+                           Kernel_Variant variant,
                            cl::Buffer* buffer_re,
                            cl::Buffer* buffer_im,
                            cl::Buffer* cmap_buf,
                            unsigned int cmap_size,
                            float c_re,
-                           float c_im);
-        void queue_kernel(cl::CommandQueue* queue);
+                           float c_im,
+                           const Attracting_Cycle& cycle,
+                           Variant_Buffers* shared = NULL);
+        void create_depth_kernel(cl::Program* program,
+                                 cl::Buffer* buffer_re,
+                                 cl::Buffer* buffer_im,
+                                 float c_re,
+                                 float c_im,
+                                 const Attracting_Cycle& cycle);
+        void create_cycle_kernel(cl::Program* program,
+                                 cl::Buffer* depths,
+                                 cl::Buffer* cmap_buf,
+                                 unsigned int cmap_size,
+                                 unsigned int phase);
+        void create_coherent_kernel(cl::Program* program,
+                                    cl::Buffer* buffer_re,
+                                    cl::Buffer* buffer_im,
+                                    cl::Buffer* depths,
+                                    cl::Buffer* certified,
+                                    cl::Buffer* cmap_buf,
+                                    unsigned int cmap_size,
+                                    float c_re,
+                                    float c_im,
+                                    double radius,
+                                    bool key_frame);
+        void create_vector_kernel(cl::Program* program,
+                                  Julia_Set* group,
+                                  unsigned int count,
+                                  cl::Buffer* buffer_re,
+                                  cl::Buffer* buffer_im,
+                                  cl::Buffer* cmap_buf,
+                                  unsigned int cmap_size,
+                                  const float* c_re,
+                                  const float* c_im);
+        void create_perturbed_kernel(cl::Program* program,
+                                     const std::vector<double>& reference,
+                                     const std::vector<double>& critical,
+                                     cl::Buffer* cmap_buf,
+                                     unsigned int cmap_size,
+                                     double pixel_size);
+        void set_launch_shape(size_t local_width, size_t local_height,
+                              unsigned int strip);
+        bool use_symmetry(cl::Program* program, bool point, bool conjugate);
+        unsigned int set_iteration_limit(unsigned int limit);
+        unsigned int iteration_limit(void);
+        void set_host_rows(size_t rows);
+        void render_host_rows(const std::vector<float>& spaced_re,
+                              const std::vector<float>& spaced_im,
+                              const cl_uint4* cmap);
+        cl::Buffer* depth_buffer(void) { return &_depth; }
+        const std::vector<uint8_t>& image(void) const { return _result; }
+        void queue_kernel(cl::CommandQueue* queue, cl::Event* event = NULL);
         void read_image_to_host(cl::CommandQueue* queue);
+        void read_depth_to_host(cl::CommandQueue* queue);
         void export_to_png(std::string filename);
         void export_to_ppm(std::string filename);
+        bool export_to_qoi(std::string filename, bool verify = false);
+        bool export_to_apng(APNG_Writer* apng);
+        void export_to_gif(GIF_Writer* gif);
+        void export_to_archive(Field_Archive_Writer* archive);
     private:
         cl_int _err;
         size_t _size;
         float _c_re;
         float _c_im;
         cl::Kernel _render_kernel;
+        cl::Kernel _mirror_kernel;
+        cl::Kernel _refine_kernel;
+        cl::Buffer _tile_counter;
+        cl::Kernel _bin_kernel;
+        cl::Kernel _prefix_kernel;
+        cl::Kernel _order_kernel;
+        cl::Kernel _resume_kernels[2];
+        unsigned int _resume_passes;
+        Variant_Buffers* _shared;
+        bool _symmetric;
+        bool _grouped;
+        Kernel_Variant _variant;
+        size_t _launch_width;
+        size_t _launch_height;
+        size_t _local_width;
+        size_t _local_height;
+        size_t _host_rows;
+        Attracting_Cycle _cycle;
         cl::Buffer* _buffer_re;
         cl::Buffer* _buffer_im;
         cl::Buffer* _cmap_buf;
         unsigned int _cmap_size;
         cl::Image2D _image;
-        cl::Context* context;
+        cl::Buffer _depth;
+        cl::Buffer _reference;
+        cl::Buffer _critical;
+        cl::Context* _context;
         cl::size_t<3> _origin;
         cl::size_t<3> _region;
-        uint8_t* _result;
+        // Host copies of the image and depths, held by value so assigning a
+        //   frame, or the frame going away, frees them
+        std::vector<uint8_t> _result;
+        std::vector<uint8_t> _depth_result;
 };
 
 #endif // JULIA_SET_H
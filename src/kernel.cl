@@ -9,6 +9,17 @@
  */
 
 
+/* Every kernel rounds each operation on its own, without contraction into
+ *   fma: the double ones so their depths match host_depth's (host_render.o
+ *   is compiled with -ffp-contract=off too), the float-float ones because
+ *   their error-free transformations need it */
+#pragma OPENCL FP_CONTRACT OFF
+
+/* Double precision is optional, devices without it only get the kernels
+ *   that don't need it */
+#ifdef cl_khr_fp64
+#pragma OPENCL EXTENSION cl_khr_fp64 : enable
+
 /* Define type Complex */
 typedef double2 Complex;
 
@@ -31,18 +42,118 @@ inline Complex c_add(Complex a, Complex b)
     return (Complex)(a.x + b.x, a.y + b.y);
 }
 
+/* Compute depth of a point from julia set complex polynomial algorithm,
+ * counting down from 255 until z escapes */
+inline unsigned char julia_depth(Complex z, Complex c)
+{
+    unsigned char depth = 255; 
+    while(c_abs(z) < 1000 && depth >= 1)
+    {
+        z = c_add(c_multiply(z, z), c);
+        depth--;
+    }
+    return depth;
+}
+
+/* Compute depth like julia_depth_cycle for an orbit that reached z with
+ *   depth left */
+inline unsigned char julia_depth_cycle_from(Complex z, Complex c,
+                                            Complex cycle,
+                                            double cycle_radius,
+                                            unsigned char depth)
+{
+    double radius2 = cycle_radius * cycle_radius;
+    while(c_abs(z) < 1000 && depth >= 1)
+    {
+        Complex d = z - cycle;
+        if (d.x * d.x + d.y * d.y < radius2)
+            return 0;
+        z = c_add(c_multiply(z, z), c);
+        depth--;
+    }
+    return depth;
+}
+
+/* Compute depth like julia_depth, but give depth 0 as soon as z is within
+ *   cycle_radius of a point of the attracting cycle: orbits in that disk
+ *   provably never escape (a radius of 0 never stops early) */
+inline unsigned char julia_depth_cycle(Complex z, Complex c, Complex cycle,
+                                       double cycle_radius)
+{
+    return julia_depth_cycle_from(z, c, cycle, cycle_radius, 255);
+}
+
+/* Compute depth like julia_depth, and whether every c' within radius of c
+ *   is certain to give the same depth. The bound e on the distance between
+ *   the orbits of c and c' includes the rounding of both, and the escape
+ *   tests keep a margin for c_abs rounding to float */
+inline unsigned char julia_depth_certified(Complex z, Complex c,
+                                           double radius, int* certified)
+{
+    const double rounding = 4.0 * DBL_EPSILON;
+    const double margin = 1e-3;
+    double c_mag = sqrt(c.x * c.x + c.y * c.y);
+    double e = 0.0;
+    unsigned char depth = 255;
+    *certified = 1;
+    while (depth >= 1)
+    {
+        double mag = sqrt(z.x * z.x + z.y * z.y);
+        if (!(c_abs(z) < 1000))
+        {
+            /* The orbit of c' must escape at the same step... */
+            if (!(mag - e >= 1000 + margin))
+                *certified = 0;
+            break;
+        }
+        /* ...and not before it */
+        if (!(mag + e < 1000 - margin))
+            *certified = 0;
+        z = c_add(c_multiply(z, z), c);
+        depth--;
+        double mag_far = mag + e;
+        e = (2.0 * mag * e + e * e + radius +
+             rounding * (mag * mag + mag_far * mag_far + 2.0 * c_mag +
+                         radius)) * (1.0 + 1e-12);
+    }
+    return depth;
+}
+
+/* Precision of the intermediate values of the grid kernels */
+typedef double grid_t;
+#else
+typedef float grid_t;
+#endif
+
+/* Get the colormap index of a depth */
+inline unsigned int depth_color_index(unsigned char depth,
+                                      unsigned int cmap_size)
+{
+    unsigned int color_index = (float)(depth - 0) /
+                               (float)(255 - 0) * cmap_size;
+    /* Depth 255 would index one past the end of the colormap */
+    return min(color_index, cmap_size - 1);
+}
+
 /* Compute evenly spaced real values */
 void kernel even_re(float center_re,
                     float zoom,
                     float size,
+                    int centered,
                     global float* out)
 {
-    float min = center_re - zoom / 2.0;
-    float max = center_re + zoom / 2.0;
+    float min = center_re - zoom / (grid_t)2;
+    float max = center_re + zoom / (grid_t)2;
     float interval = (max - min) / size;
     for (unsigned int i = 0; i < (unsigned int)size; i++)
     {
-        out[i] = min + interval * i;
+        /* Offsets from the center make a grid centered on 0 exactly
+         *   symmetric, out[size - i] == -out[i], for renders that mirror
+         *   pixels */
+        if (centered)
+            out[i] = center_re + interval * (i - size / 2.0f);
+        else
+            out[i] = min + interval * i;
     }
 }
 
@@ -50,17 +161,25 @@ void kernel even_re(float center_re,
 void kernel even_im(float center_im,
                     float zoom,
                     float size,
+                    int centered,
                     global float* out)
 {
-    float min = center_im - zoom / 2.0;
-    float max = center_im + zoom / 2.0;
+    float min = center_im - zoom / (grid_t)2;
+    float max = center_im + zoom / (grid_t)2;
     float interval = (max - min) / size;
     for (unsigned int i = 0; i < (unsigned int)size; i++)
     {
-        out[i] = min + interval * i;
+        /* Offsets from the center make a grid centered on 0 exactly
+         *   symmetric, out[size - i] == -out[i], for renders that mirror
+         *   pixels */
+        if (centered)
+            out[i] = center_im + interval * (i - size / 2.0f);
+        else
+            out[i] = min + interval * i;
     }
 }
 
+#ifdef cl_khr_fp64
 /* Compute the depth of one pixel of a fractal image */
 void kernel render_image(__write_only image2d_t image, 
                          global const float* spaced_re,
@@ -68,22 +187,923 @@ void kernel render_image(__write_only image2d_t image,
                          global const uint4* cmap,
                          unsigned int cmap_size,
                          float c_re,
-                         float c_im)
+                         float c_im,
+                         double cycle_re,
+                         double cycle_im,
+                         double cycle_radius,
+                         unsigned int strip)
+{
+    /* Get coordinate of the first pixel of the work item's strip from
+     *   NDRange global IDs. Each work item computes strip pixels of a row */
+    int2 pos = {get_global_id(0) * strip, get_global_id(1)};
+
+    Complex c = (Complex)(c_re, c_im);
+    Complex cycle = (Complex)(cycle_re, cycle_im);
+    for (unsigned int k = 0; k < strip; k++, pos.x++)
+    {
+        /* Compute depth of pixel from julia set complex polynomial
+         *   algorithm */
+        Complex z = (Complex)(spaced_re[pos.x], spaced_im[pos.y]);
+        unsigned char depth = julia_depth_cycle(z, c, cycle, cycle_radius);
+        /* Use colormap buffer to convert grayscale depth to RGB color */
+        write_imageui(image, pos,
+                      cmap[depth_color_index(depth, cmap_size)]);
+    }
+}
+
+/* Iterations render_image_unrolled runs between escape tests */
+#define UNROLL_STEPS 8
+/* Squared magnitudes below 999^2 certainly have c_abs(z) < 1000 */
+#define UNROLL_SAFE2 998001.0
+
+/* Compute pixels like render_image, four consecutive pixels of a row at
+ *   once with one per vector lane, in blocks of UNROLL_STEPS iterations
+ *   with no branches. Each step only ORs its escape and cycle tests into
+ *   a mask, checked after the block. The lanes that may have stopped in a
+ *   block redo it from its start one step at a time, which gives exactly
+ *   the depth of julia_depth_cycle, so only their last block runs twice */
+void kernel render_image_unrolled(__write_only image2d_t image,
+                                  global const float* spaced_re,
+                                  global const float* spaced_im,
+                                  global const uint4* cmap,
+                                  unsigned int cmap_size,
+                                  float c_re,
+                                  float c_im,
+                                  double cycle_re,
+                                  double cycle_im,
+                                  double cycle_radius,
+                                  unsigned int strip)
+{
+    /* Get coordinate of the first pixel of the work item's strip from
+     *   NDRange global IDs. Each work item computes strip groups of four
+     *   pixels of a row */
+    int2 pos = {get_global_id(0) * strip * 4, get_global_id(1)};
+
+    Complex c = (Complex)(c_re, c_im);
+    Complex cycle = (Complex)(cycle_re, cycle_im);
+    double radius2 = cycle_radius * cycle_radius;
+    for (unsigned int k = 0; k < strip; k++, pos.x += 4)
+    {
+        double4 z_re = convert_double4(vload4(0, spaced_re + pos.x));
+        double4 z_im = (double4)(spaced_im[pos.y]);
+        long4 done = (long4)(0);
+        unsigned char depths[4];
+        double lane_re[4];
+        double lane_im[4];
+        long lane_stop[4];
+        unsigned char depth = 255;
+        while (depth >= UNROLL_STEPS && !all(done))
+        {
+            double4 start_re = z_re;
+            double4 start_im = z_im;
+            long4 stop = (long4)(0);
+            #pragma unroll
+            for (int i = 0; i < UNROLL_STEPS; i++)
+            {
+                /* Overflowed lanes compare false and stop too */
+                double4 d_re = z_re - cycle.x;
+                double4 d_im = z_im - cycle.y;
+                stop |= !(z_re * z_re + z_im * z_im < UNROLL_SAFE2) |
+                        (d_re * d_re + d_im * d_im < radius2);
+                double4 t = z_re * z_re - z_im * z_im + c.x;
+                z_im = z_re * z_im + z_im * z_re + c.y;
+                z_re = t;
+            }
+            stop &= ~done;
+            if (any(stop))
+            {
+                vstore4(start_re, 0, lane_re);
+                vstore4(start_im, 0, lane_im);
+                vstore4(stop, 0, lane_stop);
+                for (int lane = 0; lane < 4; lane++)
+                {
+                    if (lane_stop[lane])
+                        depths[lane] = julia_depth_cycle_from(
+                            (Complex)(lane_re[lane], lane_im[lane]), c, cycle,
+                            cycle_radius, depth);
+                }
+                done |= stop;
+            }
+            depth -= UNROLL_STEPS;
+        }
+        /* Lanes still iterating finish the last steps one at a time */
+        vstore4(z_re, 0, lane_re);
+        vstore4(z_im, 0, lane_im);
+        vstore4(done, 0, lane_stop);
+        for (int lane = 0; lane < 4; lane++)
+        {
+            if (!lane_stop[lane])
+                depths[lane] = julia_depth_cycle_from(
+                    (Complex)(lane_re[lane], lane_im[lane]), c, cycle,
+                    cycle_radius, depth);
+            /* Use colormap buffer to convert grayscale depth to RGB
+             *   color */
+            write_imageui(image, (int2)(pos.x + lane, pos.y),
+                          cmap[depth_color_index(depths[lane], cmap_size)]);
+        }
+    }
+}
+
+/* Side of the square tiles render_image_persistent hands out, one pixel
+ *   per work item of a work group */
+#define PERSISTENT_TILE 8
+
+/* Keep the even bits of x, packed into its low half */
+inline unsigned int compact_bits(unsigned int x)
+{
+    x &= 0x55555555;
+    x = (x | (x >> 1)) & 0x33333333;
+    x = (x | (x >> 2)) & 0x0F0F0F0F;
+    x = (x | (x >> 4)) & 0x00FF00FF;
+    x = (x | (x >> 8)) & 0x0000FFFF;
+    return x;
+}
+
+/* Compute pixels like render_image with persistent work groups: only
+ *   enough groups to fill the device are launched, and each takes tiles
+ *   of the image from a global counter until there are none left, so
+ *   groups that got fast tiles go on to take more instead of idling
+ *   behind slow ones. Tiles are handed out in Z-order, which keeps the
+ *   tiles in flight close together. The host clears next_tile before
+ *   every launch */
+void kernel render_image_persistent(__write_only image2d_t image,
+                                    global const float* spaced_re,
+                                    global const float* spaced_im,
+                                    global const uint4* cmap,
+                                    unsigned int cmap_size,
+                                    float c_re,
+                                    float c_im,
+                                    double cycle_re,
+                                    double cycle_im,
+                                    double cycle_radius,
+                                    global unsigned int* next_tile)
+{
+    local unsigned int group_tile;
+    int size = get_image_width(image);
+    unsigned int tiles = (size + PERSISTENT_TILE - 1) / PERSISTENT_TILE;
+    /* Z-order indices cover a power of two square of tiles, those past
+     *   the image are skipped */
+    unsigned int side = 1;
+    while (side < tiles)
+        side <<= 1;
+    int2 offset = {get_local_id(0) % PERSISTENT_TILE,
+                   get_local_id(0) / PERSISTENT_TILE};
+
+    Complex c = (Complex)(c_re, c_im);
+    Complex cycle = (Complex)(cycle_re, cycle_im);
+    while (1)
+    {
+        /* One work item takes the next tile for the whole group */
+        if (get_local_id(0) == 0)
+            group_tile = atomic_inc(next_tile);
+        barrier(CLK_LOCAL_MEM_FENCE);
+        unsigned int tile = group_tile;
+        barrier(CLK_LOCAL_MEM_FENCE);
+        if (tile >= side * side)
+            return;
+        unsigned int tile_x = compact_bits(tile);
+        unsigned int tile_y = compact_bits(tile >> 1);
+        if (tile_x >= tiles || tile_y >= tiles)
+            continue;
+        int2 pos = {tile_x * PERSISTENT_TILE + offset.x,
+                    tile_y * PERSISTENT_TILE + offset.y};
+        if (pos.x >= size || pos.y >= size)
+            continue;
+        Complex z = (Complex)(spaced_re[pos.x], spaced_im[pos.y]);
+        unsigned char depth = julia_depth_cycle(z, c, cycle, cycle_radius);
+        /* Use colormap buffer to convert grayscale depth to RGB color */
+        write_imageui(image, pos, cmap[depth_color_index(depth, cmap_size)]);
+    }
+}
+
+/* First of the passes that order pixels by the depths of the frame
+ *   rendered before, whose neighbours in the order then cost about the
+ *   same: count the pixels of each depth */
+void kernel bin_depths(global const uchar* depths,
+                       global unsigned int* bins)
+{
+    atomic_inc(&bins[depths[get_global_id(0)]]);
+}
+
+/* Turn the counts into the index the pixels of each depth start at, from
+ *   depth 0 (the most iterations) up. 256 bins are too few to be worth
+ *   more than one work item */
+void kernel prefix_bins(global unsigned int* bins)
+{
+    unsigned int start = 0;
+    for (int i = 0; i < 256; i++)
+    {
+        unsigned int count = bins[i];
+        bins[i] = start;
+        start += count;
+    }
+}
+
+/* Append every pixel to the range of its depth */
+void kernel order_pixels(global const uchar* depths,
+                         global unsigned int* bins,
+                         global unsigned int* order)
+{
+    size_t i = get_global_id(0);
+    order[atomic_inc(&bins[depths[i]])] = i;
+}
+
+/* Compute pixels like render_image, the i-th work item computing the
+ *   pixel order[i] and writing it back in place. Its depth goes to the
+ *   depths buffer for the next frame to order its pixels by */
+void kernel render_image_sorted(__write_only image2d_t image,
+                                global const float* spaced_re,
+                                global const float* spaced_im,
+                                global const uint4* cmap,
+                                unsigned int cmap_size,
+                                float c_re,
+                                float c_im,
+                                double cycle_re,
+                                double cycle_im,
+                                double cycle_radius,
+                                global const unsigned int* order,
+                                global uchar* depths)
+{
+    unsigned int pixel = order[get_global_id(0)];
+    unsigned int width = get_image_width(image);
+    int2 pos = {pixel % width, pixel / width};
+
+    Complex z = (Complex)(spaced_re[pos.x], spaced_im[pos.y]);
+    Complex c = (Complex)(c_re, c_im);
+    Complex cycle = (Complex)(cycle_re, cycle_im);
+    unsigned char depth = julia_depth_cycle(z, c, cycle, cycle_radius);
+    depths[pixel] = depth;
+    /* Use colormap buffer to convert grayscale depth to RGB color */
+    write_imageui(image, pos, cmap[depth_color_index(depth, cmap_size)]);
+}
+
+/* Iterations per pass of the resumable kernels, whose later passes only
+ *   continue the pixels earlier ones left unresolved */
+#define RESUME_STEPS 32
+
+/* Orbit of a pixel that hasn't got its depth yet, where the next pass
+ *   continues it */
+typedef struct
+{
+    Complex z;
+    unsigned int pixel;
+    unsigned int depth;
+} Resume_State;
+
+/* Run at most RESUME_STEPS iterations of julia_depth_cycle_from on *z with
+ *   *depth left, stopping at stop depth left instead of 0 (which limits
+ *   the iterations to 255 - stop). Returns whether *depth is the final
+ *   depth, else *z and *depth are where to resume */
+inline int julia_depth_cycle_steps(Complex* z, Complex c, Complex cycle,
+                                   double cycle_radius, unsigned int stop,
+                                   unsigned char* depth)
+{
+    double radius2 = cycle_radius * cycle_radius;
+    Complex w = *z;
+    unsigned char left = *depth;
+    for (int i = 0; i < RESUME_STEPS; i++)
+    {
+        if (!(c_abs(w) < 1000))
+        {
+            *depth = left;
+            return 1;
+        }
+        /* Running out of iterations counts as never escaping, like in
+         *   julia_depth, and so does reaching the cycle */
+        Complex d = w - cycle;
+        if (left <= stop || d.x * d.x + d.y * d.y < radius2)
+        {
+            *depth = 0;
+            return 1;
+        }
+        w = c_add(c_multiply(w, w), c);
+        left--;
+    }
+    *z = w;
+    *depth = left;
+    return 0;
+}
+
+/* First pass of a resumable render: compute one pixel like render_image
+ *   for at most RESUME_STEPS iterations, and append it to out if it isn't
+ *   resolved by then. A stop above 0 lowers the iteration limit to make
+ *   fewer passes enough, pixels out of iterations get depth 0 */
+void kernel render_image_resumable(__write_only image2d_t image,
+                                   global const float* spaced_re,
+                                   global const float* spaced_im,
+                                   global const uint4* cmap,
+                                   unsigned int cmap_size,
+                                   float c_re,
+                                   float c_im,
+                                   double cycle_re,
+                                   double cycle_im,
+                                   double cycle_radius,
+                                   global Resume_State* out,
+                                   global unsigned int* out_count,
+                                   unsigned int stop)
 {
     /* Get pixel coordinate from NDRange global IDs */
     int2 pos = {get_global_id(0), get_global_id(1)};
 
-    /* Compute depth of pixel from julia set complex polynomial algorithm */
     Complex z = (Complex)(spaced_re[pos.x], spaced_im[pos.y]);
     Complex c = (Complex)(c_re, c_im);
-    unsigned char depth = 255; 
-    while(c_abs(z) < 1000 && depth >= 1)
+    Complex cycle = (Complex)(cycle_re, cycle_im);
+    unsigned char depth = 255;
+    if (julia_depth_cycle_steps(&z, c, cycle, cycle_radius, stop, &depth))
     {
-        z = c_add(c_multiply(z, z), c);
+        write_imageui(image, pos, cmap[depth_color_index(depth, cmap_size)]);
+        return;
+    }
+    Resume_State state = {z, pos.y * get_global_size(0) + pos.x, depth};
+    out[atomic_inc(out_count)] = state;
+}
+
+/* Later passes of a resumable render: continue the pixels the pass before
+ *   left in in for at most RESUME_STEPS more iterations each, appending
+ *   the ones still unresolved to out. Launched over every pixel, only the
+ *   first in_count items work, so once every pixel has its depth the
+ *   remaining passes return at once */
+void kernel resume_pixels(__write_only image2d_t image,
+                          global const uint4* cmap,
+                          unsigned int cmap_size,
+                          float c_re,
+                          float c_im,
+                          double cycle_re,
+                          double cycle_im,
+                          double cycle_radius,
+                          global const Resume_State* in,
+                          global const unsigned int* in_count,
+                          global Resume_State* out,
+                          global unsigned int* out_count,
+                          unsigned int stop)
+{
+    size_t i = get_global_id(0);
+    if (i >= *in_count)
+        return;
+    Resume_State state = in[i];
+    unsigned int width = get_image_width(image);
+    int2 pos = {state.pixel % width, state.pixel / width};
+
+    Complex c = (Complex)(c_re, c_im);
+    Complex cycle = (Complex)(cycle_re, cycle_im);
+    unsigned char depth = state.depth;
+    if (julia_depth_cycle_steps(&state.z, c, cycle, cycle_radius, stop,
+                                &depth))
+    {
+        write_imageui(image, pos, cmap[depth_color_index(depth, cmap_size)]);
+        return;
+    }
+    state.depth = depth;
+    out[atomic_inc(out_count)] = state;
+}
+
+/* Compute the depth of one pixel of four consecutive frames at once, one
+ *   frame per vector lane (SIMD across time instead of space). Nearby c
+ *   values give nearly the same depths, so lanes rarely wait for each
+ *   other, and every lane does the same arithmetic as julia_depth */
+void kernel render_images4(__write_only image2d_t image0,
+                           __write_only image2d_t image1,
+                           __write_only image2d_t image2,
+                           __write_only image2d_t image3,
+                           global const float* spaced_re,
+                           global const float* spaced_im,
+                           global const uint4* cmap,
+                           unsigned int cmap_size,
+                           float4 c_re,
+                           float4 c_im)
+{
+    /* Get pixel coordinate from NDRange global IDs */
+    int2 pos = {get_global_id(0), get_global_id(1)};
+
+    double4 z_re = (double4)(spaced_re[pos.x]);
+    double4 z_im = (double4)(spaced_im[pos.y]);
+    double4 cv_re = convert_double4(c_re);
+    double4 cv_im = convert_double4(c_im);
+    /* Lanes count down from 255 while they haven't escaped */
+    long4 depth = (long4)(255);
+    long4 active = (long4)(-1);
+    for (int i = 0; i < 255; i++)
+    {
+        double4 mag = sqrt(z_re * z_re + z_im * z_im);
+        active &= convert_long4(convert_float4(mag) < 1000.0f);
+        if (!any(active))
+            break;
+        double4 t = z_re * z_re - z_im * z_im + cv_re;
+        z_im = z_re * z_im + z_im * z_re + cv_im;
+        z_re = t;
+        depth += active;
+    }
+    write_imageui(image0, pos,
+                  cmap[depth_color_index((uchar)depth.s0, cmap_size)]);
+    write_imageui(image1, pos,
+                  cmap[depth_color_index((uchar)depth.s1, cmap_size)]);
+    write_imageui(image2, pos,
+                  cmap[depth_color_index((uchar)depth.s2, cmap_size)]);
+    write_imageui(image3, pos,
+                  cmap[depth_color_index((uchar)depth.s3, cmap_size)]);
+}
+
+/* Compute the depth of one pixel of a fractal image without applying the
+ *   colormap, so the depth can be used directly as a palette index */
+void kernel render_depth(global uchar* depths,
+                         global const float* spaced_re,
+                         global const float* spaced_im,
+                         float c_re,
+                         float c_im,
+                         double cycle_re,
+                         double cycle_im,
+                         double cycle_radius,
+                         unsigned int width)
+{
+    /* Get pixel coordinate from NDRange global IDs */
+    int2 pos = {get_global_id(0), get_global_id(1)};
+
+    Complex z = (Complex)(spaced_re[pos.x], spaced_im[pos.y]);
+    Complex c = (Complex)(c_re, c_im);
+    Complex cycle = (Complex)(cycle_re, cycle_im);
+    depths[pos.y * width + pos.x] =
+        julia_depth_cycle(z, c, cycle, cycle_radius);
+}
+
+/* Color one pixel from a depth field that render_depth computed for only
+ *   part of the image. Julia sets of z^2 + c are symmetric under z -> -z,
+ *   and under z -> conj(z) when c is real, so on a grid with the same
+ *   symmetry a pixel outside the computed rows (or quarter, when both
+ *   symmetries hold) has exactly the depth of its mirror pixel */
+void kernel mirror_colors(__write_only image2d_t image,
+                          global const uchar* depths,
+                          global const float* spaced_re,
+                          global const float* spaced_im,
+                          global const uint4* cmap,
+                          unsigned int cmap_size,
+                          float c_re,
+                          float c_im,
+                          double cycle_re,
+                          double cycle_im,
+                          double cycle_radius,
+                          int point,
+                          int conjugate)
+{
+    /* Get pixel coordinate from NDRange global IDs */
+    int2 pos = {get_global_id(0), get_global_id(1)};
+    int size = get_global_size(0);
+    int half = size / 2;
+
+    int2 src = pos;
+    int direct = 0;
+    if (point && conjugate)
+    {
+        /* Both reflections hold, only the top left quarter was computed */
+        if (src.x > half)
+            src.x = size - src.x;
+        if (src.y > half)
+            src.y = size - src.y;
+    }
+    else if (pos.y > half)
+    {
+        if (conjugate)
+            src.y = size - pos.y;
+        else if (pos.x > 0)
+            src = (int2)(size - pos.x, size - pos.y);
+        else
+            direct = 1; /* -z of column 0 lies outside the grid */
+    }
+
+    unsigned char depth;
+    if (direct)
+    {
+        Complex z = (Complex)(spaced_re[pos.x], spaced_im[pos.y]);
+        Complex c = (Complex)(c_re, c_im);
+        Complex cycle = (Complex)(cycle_re, cycle_im);
+        depth = julia_depth_cycle(z, c, cycle, cycle_radius);
+    }
+    else
+        depth = depths[src.y * size + src.x];
+    write_imageui(image, pos, cmap[depth_color_index(depth, cmap_size)]);
+}
+
+/* Color one pixel of a precomputed depth field with the colormap rotated
+ *   by phase entries, so a palette cycling animation only computes the
+ *   fractal once */
+void kernel cycle_colors(__write_only image2d_t image,
+                         global const uchar* depths,
+                         global const uint4* cmap,
+                         unsigned int cmap_size,
+                         unsigned int phase)
+{
+    /* Get pixel coordinate from NDRange global IDs */
+    int2 pos = {get_global_id(0), get_global_id(1)};
+
+    unsigned char depth = depths[pos.y * get_global_size(0) + pos.x];
+    unsigned int color_index = depth_color_index(depth, cmap_size);
+    /* Points that never escape (depth 0) keep their color */
+    if (depth > 0)
+        color_index = (color_index + phase) % cmap_size;
+    write_imageui(image, pos, cmap[color_index]);
+}
+
+/* Compute one pixel of an animation rendered in groups of three frames.
+ *   The middle (key) frame computes every depth and marks the ones that are
+ *   certain to be the same for the frames before and after it, which then
+ *   only compute the other pixels */
+void kernel render_coherent(__write_only image2d_t image,
+                            global uchar* depths,
+                            global uchar* certified,
+                            global const float* spaced_re,
+                            global const float* spaced_im,
+                            global const uint4* cmap,
+                            unsigned int cmap_size,
+                            float c_re,
+                            float c_im,
+                            double radius,
+                            int key_frame)
+{
+    /* Get pixel coordinate from NDRange global IDs */
+    int2 pos = {get_global_id(0), get_global_id(1)};
+    size_t i = pos.y * get_global_size(0) + pos.x;
+
+    Complex z = (Complex)(spaced_re[pos.x], spaced_im[pos.y]);
+    Complex c = (Complex)(c_re, c_im);
+    unsigned char depth;
+    if (key_frame)
+    {
+        int is_certified;
+        depth = julia_depth_certified(z, c, radius, &is_certified);
+        depths[i] = depth;
+        certified[i] = is_certified;
+    }
+    else if (certified[i])
+        depth = depths[i];
+    else
+        depth = julia_depth(z, c);
+    write_imageui(image, pos, cmap[depth_color_index(depth, cmap_size)]);
+}
+
+/* Compute one pixel of a deep zoom by perturbation. Pixel coordinates that
+ *   differ by less than a double can resolve near the zoom center are the
+ *   reference point (whose orbit the host computed with enough precision)
+ *   plus a small delta, and the delta is iterated in double instead:
+ *   delta' = (2 Z + delta) delta keeps z = Z + delta on the orbit of the
+ *   pixel. Once |z| < |delta| the delta is as big as z itself, and
+ *   iterating it against Z would cancel the bits that distinguish nearby
+ *   pixels (a glitch), so the delta is rebased onto the orbit of 0 by
+ *   setting it to z. The same rebasing continues pixels that outlive the
+ *   reference orbit */
+void kernel render_perturbed(__write_only image2d_t image,
+                             global const Complex* reference,
+                             unsigned int reference_length,
+                             global const Complex* critical,
+                             unsigned int critical_length,
+                             global const uint4* cmap,
+                             unsigned int cmap_size,
+                             double pixel_size)
+{
+    /* Get pixel coordinate from NDRange global IDs */
+    int2 pos = {get_global_id(0), get_global_id(1)};
+    double half = get_global_size(0) / 2.0;
+
+    Complex delta = (Complex)((pos.x - half) * pixel_size,
+                              (pos.y - half) * pixel_size);
+    global const Complex* orbit = reference;
+    unsigned int length = reference_length;
+    unsigned int n = 0;
+    Complex z = c_add(orbit[0], delta);
+    unsigned char depth = 255;
+    while (c_abs(z) < 1000 && depth >= 1)
+    {
+        if (n == length - 1 ||
+            z.x * z.x + z.y * z.y < delta.x * delta.x + delta.y * delta.y)
+        {
+            /* critical[0] is 0, so z stays the same */
+            delta = z;
+            orbit = critical;
+            length = critical_length;
+            n = 0;
+        }
+        delta = c_multiply(c_add(c_add(orbit[n], orbit[n]), delta), delta);
+        n++;
+        z = c_add(orbit[n], delta);
         depth--;
     }
     /* Use colormap buffer to convert grayscale depth to RGB color */
-    unsigned int color_index = (float)(depth - 0) /
-                               (float)(255 - 0) * cmap_size;
-    write_imageui(image, pos, cmap[color_index]);
+    write_imageui(image, pos, cmap[depth_color_index(depth, cmap_size)]);
+}
+
+/* Second pass of render_image_mixed: recompute the pixels the float pass
+ *   couldn't certify, whose indices it appended to flagged */
+void kernel refine_flagged(__write_only image2d_t image,
+                           global const float* spaced_re,
+                           global const float* spaced_im,
+                           global const uint4* cmap,
+                           unsigned int cmap_size,
+                           float c_re,
+                           float c_im,
+                           double cycle_re,
+                           double cycle_im,
+                           double cycle_radius,
+                           global const unsigned int* flagged,
+                           global const unsigned int* flagged_count)
+{
+    /* Launched over every pixel, only the first flagged_count items work */
+    size_t i = get_global_id(0);
+    if (i >= *flagged_count)
+        return;
+    unsigned int width = get_image_width(image);
+    int2 pos = {flagged[i] % width, flagged[i] / width};
+
+    Complex z = (Complex)(spaced_re[pos.x], spaced_im[pos.y]);
+    Complex c = (Complex)(c_re, c_im);
+    Complex cycle = (Complex)(cycle_re, cycle_im);
+    unsigned char depth = julia_depth_cycle(z, c, cycle, cycle_radius);
+    write_imageui(image, pos, cmap[depth_color_index(depth, cmap_size)]);
+}
+#endif
+
+/* Float-float arithmetic: a value is the unevaluated sum hi + lo of two
+ *   floats, about 48 bits of precision for devices whose double precision
+ *   is missing or slow. Its error-free transformations rely on the
+ *   FP_CONTRACT OFF at the top of the file */
+typedef float2 Float_Float;
+
+/* Sum of two floats as hi + lo, exactly */
+inline Float_Float ff_two_sum(float a, float b)
+{
+    float s = a + b;
+    float v = s - a;
+    return (Float_Float)(s, (a - (s - v)) + (b - v));
+}
+
+/* Like ff_two_sum, for |a| >= |b| */
+inline Float_Float ff_quick_two_sum(float a, float b)
+{
+    float s = a + b;
+    return (Float_Float)(s, b - (s - a));
+}
+
+/* Product of two floats as hi + lo, exactly */
+inline Float_Float ff_two_product(float a, float b)
+{
+    float p = a * b;
+#ifdef FP_FAST_FMAF
+    return (Float_Float)(p, fma(a, b, -p));
+#else
+    /* Split each factor into 12-bit halves whose products are exact */
+    float t = 4097.0f * a;
+    float a_hi = t - (t - a);
+    float a_lo = a - a_hi;
+    t = 4097.0f * b;
+    float b_hi = t - (t - b);
+    float b_lo = b - b_hi;
+    return (Float_Float)(p, ((a_hi * b_hi - p) + a_hi * b_lo + a_lo * b_hi) +
+                            a_lo * b_lo);
+#endif
+}
+
+/* Add float-float numbers */
+inline Float_Float ff_add(Float_Float a, Float_Float b)
+{
+    Float_Float s = ff_two_sum(a.x, b.x);
+    Float_Float t = ff_two_sum(a.y, b.y);
+    s = ff_quick_two_sum(s.x, s.y + t.x);
+    return ff_quick_two_sum(s.x, s.y + t.y);
+}
+
+/* Multiply float-float numbers */
+inline Float_Float ff_multiply(Float_Float a, Float_Float b)
+{
+    Float_Float p = ff_two_product(a.x, b.x);
+    return ff_quick_two_sum(p.x, p.y + (a.x * b.y + a.y * b.x));
+}
+
+/* Compute depth like julia_depth_cycle in float-float arithmetic. The
+ *   cycle test only looks at the hi parts, so the host passes a radius
+ *   that is smaller by more than their rounding */
+inline unsigned char ff_julia_depth_cycle(float z_re, float z_im,
+                                          float c_re, float c_im,
+                                          float cycle_re, float cycle_im,
+                                          float cycle_radius)
+{
+    Float_Float re = (Float_Float)(z_re, 0.0f);
+    Float_Float im = (Float_Float)(z_im, 0.0f);
+    Float_Float cr = (Float_Float)(c_re, 0.0f);
+    Float_Float ci = (Float_Float)(c_im, 0.0f);
+    float radius2 = cycle_radius * cycle_radius;
+    unsigned char depth = 255;
+    while (sqrt(re.x * re.x + im.x * im.x) < 1000 && depth >= 1)
+    {
+        float d_re = re.x - cycle_re;
+        float d_im = im.x - cycle_im;
+        if (d_re * d_re + d_im * d_im < radius2)
+            return 0;
+        Float_Float re2 = ff_multiply(re, re);
+        Float_Float im2 = ff_multiply(im, im);
+        Float_Float cross = ff_multiply(re, im);
+        im = ff_add(ff_add(cross, cross), ci);
+        re = ff_add(ff_add(re2, -im2), cr);
+        depth--;
+    }
+    return depth;
+}
+
+/* Compute the depth of one pixel of a fractal image like render_image, in
+ *   float-float arithmetic */
+void kernel render_image_ff(__write_only image2d_t image,
+                            global const float* spaced_re,
+                            global const float* spaced_im,
+                            global const uint4* cmap,
+                            unsigned int cmap_size,
+                            float c_re,
+                            float c_im,
+                            float cycle_re,
+                            float cycle_im,
+                            float cycle_radius,
+                            unsigned int strip)
+{
+    /* Get coordinate of the first pixel of the work item's strip from
+     *   NDRange global IDs */
+    int2 pos = {get_global_id(0) * strip, get_global_id(1)};
+
+    for (unsigned int k = 0; k < strip; k++, pos.x++)
+    {
+        unsigned char depth = ff_julia_depth_cycle(spaced_re[pos.x],
+                                                   spaced_im[pos.y],
+                                                   c_re, c_im,
+                                                   cycle_re, cycle_im,
+                                                   cycle_radius);
+        /* Use colormap buffer to convert grayscale depth to RGB color */
+        write_imageui(image, pos,
+                      cmap[depth_color_index(depth, cmap_size)]);
+    }
+}
+
+/* Compute depth like julia_depth_cycle in float, and whether the depth is
+ *   certain to be the one double precision gives: e bounds the distance to
+ *   the exact orbit like in julia_depth_certified, which the double orbit
+ *   is much closer to. Stops as soon as that isn't certain */
+inline unsigned char julia_depth_float_certified(float z_re, float z_im,
+                                                 float c_re, float c_im,
+                                                 float cycle_re,
+                                                 float cycle_im,
+                                                 float cycle_radius,
+                                                 int* certified)
+{
+    const float rounding = 4.0f * FLT_EPSILON;
+    const float margin = 1e-3f;
+    float c_mag = sqrt(c_re * c_re + c_im * c_im);
+    float e = 0.0f;
+    unsigned char depth = 255;
+    *certified = 1;
+    while (depth >= 1)
+    {
+        float mag = sqrt(z_re * z_re + z_im * z_im);
+        if (!(mag < 1000))
+        {
+            if (!(mag - e >= 1000 + margin))
+                *certified = 0;
+            break;
+        }
+        if (!(mag + e < 1000 - margin))
+        {
+            *certified = 0;
+            break;
+        }
+        /* The exact orbit is inside the attracting cycle's disk too */
+        float d_re = z_re - cycle_re;
+        float d_im = z_im - cycle_im;
+        if (sqrt(d_re * d_re + d_im * d_im) + e < cycle_radius)
+            return 0;
+        float t = z_re * z_re - z_im * z_im + c_re;
+        z_im = z_re * z_im + z_im * z_re + c_im;
+        z_re = t;
+        depth--;
+        float mag_far = mag + e;
+        e = (2.0f * mag * e + e * e +
+             rounding * (mag * mag + mag_far * mag_far + 2.0f * c_mag)) *
+            (1.0f + 1e-5f);
+    }
+    return depth;
+}
+
+/* First pass of a two-pass render: compute one pixel like render_image in
+ *   float, and write it if its depth is certain, else append it to flagged
+ *   for refine_flagged to recompute in double precision. Most escaping
+ *   pixels never need the second pass */
+void kernel render_image_mixed(__write_only image2d_t image,
+                               global const float* spaced_re,
+                               global const float* spaced_im,
+                               global const uint4* cmap,
+                               unsigned int cmap_size,
+                               float c_re,
+                               float c_im,
+                               float cycle_re,
+                               float cycle_im,
+                               float cycle_radius,
+                               global unsigned int* flagged,
+                               global unsigned int* flagged_count,
+                               unsigned int strip)
+{
+    /* Get coordinate of the first pixel of the work item's strip from
+     *   NDRange global IDs */
+    int2 pos = {get_global_id(0) * strip, get_global_id(1)};
+    unsigned int width = get_image_width(image);
+
+    for (unsigned int k = 0; k < strip; k++, pos.x++)
+    {
+        int certified;
+        unsigned char depth =
+            julia_depth_float_certified(spaced_re[pos.x], spaced_im[pos.y],
+                                        c_re, c_im,
+                                        cycle_re, cycle_im, cycle_radius,
+                                        &certified);
+        if (certified)
+            write_imageui(image, pos,
+                          cmap[depth_color_index(depth, cmap_size)]);
+        else
+            flagged[atomic_inc(flagged_count)] = pos.y * width + pos.x;
+    }
+}
+
+/* Fixed point arithmetic for devices whose integer units are much faster
+ *   than their floating point ones: a long holds a real number times 2^52,
+ *   so values up to 2048 fit, and mul_hi gives products with 40 fraction
+ *   bits that can't overflow below the escape radius */
+#define FIXED_ONE 0x1p52f
+/* Magnitudes of 2047 and up don't fit, and have escaped */
+#define FIXED_LIMIT ((long)2047 << 40)
+/* Squared magnitudes with 40 fraction bits from (1000 - 2^-15)^2, the
+ *   smallest magnitude c_abs rounds to 1000 */
+#define FIXED_ESCAPE2 1099511560667137024L
+
+/* Multiply fixed point numbers, rounding toward -infinity */
+inline long fixed_multiply(long a, long b)
+{
+    return (long)((ulong)mul_hi(a, b) << 12) |
+           (long)(((ulong)a * (ulong)b) >> 52);
+}
+
+/* Compute depth like julia_depth_cycle in fixed point. A z that overflows
+ *   has escaped, so it stops there without computing it. The host passes
+ *   the squared cycle radius with 40 fraction bits, rounded down */
+inline unsigned char fixed_julia_depth_cycle(long z_re, long z_im,
+                                             long c_re, long c_im,
+                                             long cycle_re, long cycle_im,
+                                             long cycle_radius2)
+{
+    unsigned char depth = 255;
+    while (depth >= 1)
+    {
+        long re2 = mul_hi(z_re, z_re);
+        long im2 = mul_hi(z_im, z_im);
+        if (!(re2 + im2 < FIXED_ESCAPE2))
+            break;
+        long d_re = z_re - cycle_re;
+        long d_im = z_im - cycle_im;
+        if (mul_hi(d_re, d_re) + mul_hi(d_im, d_im) < cycle_radius2)
+            return 0;
+        /* Next z with 40 fraction bits, to test it for overflow */
+        long cross = mul_hi(z_re, z_im);
+        long next_re = re2 - im2 + (c_re >> 12);
+        long next_im = cross + cross + (c_im >> 12);
+        depth--;
+        if (abs(next_re) >= FIXED_LIMIT || abs(next_im) >= FIXED_LIMIT)
+            break;
+        cross = fixed_multiply(z_re, z_im);
+        z_re = fixed_multiply(z_re, z_re) - fixed_multiply(z_im, z_im) + c_re;
+        z_im = cross + cross + c_im;
+    }
+    return depth;
+}
+
+/* Compute the depth of one pixel of a fractal image like render_image, in
+ *   fixed point. Floats of the grid and c convert exactly */
+void kernel render_image_fixed(__write_only image2d_t image,
+                               global const float* spaced_re,
+                               global const float* spaced_im,
+                               global const uint4* cmap,
+                               unsigned int cmap_size,
+                               float c_re,
+                               float c_im,
+                               long cycle_re,
+                               long cycle_im,
+                               long cycle_radius2,
+                               unsigned int strip)
+{
+    /* Get coordinate of the first pixel of the work item's strip from
+     *   NDRange global IDs */
+    int2 pos = {get_global_id(0) * strip, get_global_id(1)};
+
+    long z_im = convert_long(spaced_im[pos.y] * FIXED_ONE);
+    long fixed_c_re = convert_long(c_re * FIXED_ONE);
+    long fixed_c_im = convert_long(c_im * FIXED_ONE);
+    for (unsigned int k = 0; k < strip; k++, pos.x++)
+    {
+        unsigned char depth =
+            fixed_julia_depth_cycle(convert_long(spaced_re[pos.x] *
+                                                 FIXED_ONE),
+                                    z_im, fixed_c_re, fixed_c_im,
+                                    cycle_re, cycle_im, cycle_radius2);
+        /* Use colormap buffer to convert grayscale depth to RGB color */
+        write_imageui(image, pos,
+                      cmap[depth_color_index(depth, cmap_size)]);
+    }
 }
@@ -1317,6 +1317,21 @@ static unsigned inflate(unsigned char** out, size_t* outsize,
 
 static const size_t MAX_SUPPORTED_DEFLATE_LENGTH = 258;
 
+/*Match finder speedups: SSE2 / 64-bit word compares need unaligned loads and a count trailing zeros
+builtin, prefetching only changes timing. Define LODEPNG_NO_FAST_MATCH to use plain byte loops.*/
+#if !defined(LODEPNG_NO_FAST_MATCH) && defined(__GNUC__)
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define LODEPNG_FAST_MATCH_WORDS
+#endif
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define LODEPNG_FAST_MATCH_SSE2
+#endif
+#define LODEPNG_PREFETCH(p) __builtin_prefetch(p)
+#else
+#define LODEPNG_PREFETCH(p)
+#endif
+
 /*bitlen is the size in bits of the code*/
 static void addHuffmanSymbol(size_t* bp, ucvector* compressed, unsigned code, unsigned bitlen)
 {
@@ -1423,13 +1438,13 @@ static unsigned getHash(const unsigned char* data, size_t size, size_t pos)
   unsigned result = 0;
   if(pos + 2 < size)
   {
-    /*A simple shift and xor hash is used. Since the data of PNGs is dominated
-    by zeroes due to the filters, a better hash does not have a significant
-    effect on speed in traversing the chain, and causes more time spend on
-    calculating the hash.*/
-    result ^= (unsigned)(data[pos + 0] << 0u);
-    result ^= (unsigned)(data[pos + 1] << 4u);
-    result ^= (unsigned)(data[pos + 2] << 8u);
+    /*Multiplicative (Fibonacci) hash of the 3 bytes, keeping the top 16 bits of the
+    product. Filtered fractal scanlines contain many distinct but similar triplets
+    (small deltas around zero), which collide heavily under a shift and xor hash and
+    make the chains long. Three zero bytes still hash to 0, which the zeros chain
+    relies on.*/
+    result = (unsigned)data[pos + 0] | ((unsigned)data[pos + 1] << 8u) | ((unsigned)data[pos + 2] << 16u);
+    result = (unsigned)((result * 2654435761u) & 0xffffffffu) >> 16u;
   } else {
     size_t amount, i;
     if(pos >= size) return 0;
@@ -1439,15 +1454,52 @@ static unsigned getHash(const unsigned char* data, size_t size, size_t pos)
   return result & HASH_BIT_MASK;
 }
 
+/*Returns the amount of equal bytes at a and b, comparing no further than end (the end of a).
+Compares 16 bytes at once with SSE2 or 8 bytes at once as a 64-bit word where available, and
+finds the first differing byte with a count trailing zeros instruction.*/
+static unsigned countMatch(const unsigned char* a, const unsigned char* b, const unsigned char* end)
+{
+  const unsigned char* start = a;
+#if defined(LODEPNG_FAST_MATCH_SSE2)
+  while(end - a >= 16)
+  {
+    __m128i va = _mm_loadu_si128((const __m128i*)a);
+    __m128i vb = _mm_loadu_si128((const __m128i*)b);
+    unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) ^ 0xffffu;
+    if(mask) return (unsigned)(a - start) + (unsigned)__builtin_ctz(mask);
+    a += 16;
+    b += 16;
+  }
+#endif /*LODEPNG_FAST_MATCH_SSE2*/
+#if defined(LODEPNG_FAST_MATCH_WORDS)
+  while(end - a >= 8)
+  {
+    unsigned long long wa, wb, diff;
+    memcpy(&wa, a, 8);
+    memcpy(&wb, b, 8);
+    diff = wa ^ wb;
+    /*on little endian, the first differing byte is the lowest set byte of the xor*/
+    if(diff) return (unsigned)(a - start) + (unsigned)(__builtin_ctzll(diff) >> 3);
+    a += 8;
+    b += 8;
+  }
+#endif /*LODEPNG_FAST_MATCH_WORDS*/
+  while(a != end && *a == *b)
+  {
+    ++a;
+    ++b;
+  }
+  /*subtracting two addresses returned as 32-bit number (max value is MAX_SUPPORTED_DEFLATE_LENGTH)*/
+  return (unsigned)(a - start);
+}
+
 static unsigned countZeros(const unsigned char* data, size_t size, size_t pos)
 {
+  static const unsigned char zeros[258] = {0}; /*MAX_SUPPORTED_DEFLATE_LENGTH*/
   const unsigned char* start = data + pos;
   const unsigned char* end = start + MAX_SUPPORTED_DEFLATE_LENGTH;
   if(end > data + size) end = data + size;
-  data = start;
-  while(data != end && *data == 0) ++data;
-  /*subtracting two addresses returned as 32-bit number (max value is MAX_SUPPORTED_DEFLATE_LENGTH)*/
-  return (unsigned)(data - start);
+  return countMatch(start, zeros, end);
 }
 
 /*wpos = pos & (windowsize - 1)*/
@@ -1490,7 +1542,7 @@ static unsigned encodeLZ77(uivector* out, Hash* hash,
   unsigned lazylength = 0, lazyoffset = 0;
   unsigned hashval;
   unsigned current_offset, current_length;
-  unsigned prev_offset;
+  unsigned prev_offset, next_offset;
   const unsigned char *lastptr, *foreptr, *backptr;
   unsigned hashpos;
 
@@ -1541,29 +1593,36 @@ static unsigned encodeLZ77(uivector* out, Hash* hash,
         foreptr = &in[pos];
         backptr = &in[pos - current_offset];
 
-        /*common case in PNGs is lots of zeros. Quickly skip over them as a speedup*/
-        if(numzeros >= 3)
-        {
-          unsigned skip = hash->zeros[hashpos];
-          if(skip > numzeros) skip = numzeros;
-          backptr += skip;
-          foreptr += skip;
-        }
+        /*fetch the data of the next chain entry while this one is compared. The address is only
+        formed when that entry lies within the data already seen*/
+        next_offset = hash->chain[hashpos] <= wpos ? wpos - hash->chain[hashpos]
+                                                   : wpos - hash->chain[hashpos] + windowsize;
+        if(next_offset <= pos) LODEPNG_PREFETCH(&in[pos - next_offset]);
 
-        while(foreptr != lastptr && *backptr == *foreptr) /*maximum supported length by deflate is max length*/
+        /*a match can only be longer than the current best if it also matches at that length.
+        Checking that single byte first rejects most chain entries without a full compare*/
+        if(length == 0 || foreptr + length >= lastptr || backptr[length] == foreptr[length])
         {
-          ++backptr;
-          ++foreptr;
-        }
-        current_length = (unsigned)(foreptr - &in[pos]);
+          /*common case in PNGs is lots of zeros. Quickly skip over them as a speedup*/
+          if(numzeros >= 3)
+          {
+            unsigned skip = hash->zeros[hashpos];
+            if(skip > numzeros) skip = numzeros;
+            backptr += skip;
+            foreptr += skip;
+          }
 
-        if(current_length > length)
-        {
-          length = current_length; /*the longest length*/
-          offset = current_offset; /*the offset that is related to this longest length*/
-          /*jump out once a length of max length is found (speed gain). This also jumps
-          out if length is MAX_SUPPORTED_DEFLATE_LENGTH*/
-          if(current_length >= nicematch) break;
+          /*maximum supported length by deflate is max length*/
+          current_length = (unsigned)(foreptr - &in[pos]) + countMatch(foreptr, backptr, lastptr);
+
+          if(current_length > length)
+          {
+            length = current_length; /*the longest length*/
+            offset = current_offset; /*the offset that is related to this longest length*/
+            /*jump out once a length of max length is found (speed gain). This also jumps
+            out if length is MAX_SUPPORTED_DEFLATE_LENGTH*/
+            if(current_length >= nicematch) break;
+          }
         }
       }
 
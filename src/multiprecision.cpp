@@ -0,0 +1,214 @@
+//  multiprecision.cpp
+//
+//  Source code for fixed point real number functions
+
+
+#include <cmath>
+#include <algorithm>
+#include "multiprecision.hpp"
+
+
+Fixed_Real::Fixed_Real(void)
+{
+    _negative = false;
+    _limbs.assign(1, 0);
+}
+
+
+Fixed_Real::Fixed_Real(double value, unsigned int fraction_limbs)
+{
+    // Exact for doubles with a magnitude below 2^32, since the fraction
+    //   bits of a double all fit in the first two fraction limbs...
+    //   unless the value is tiny, then bits below the last limb are lost
+    _negative = value < 0;
+    _limbs.assign(1 + fraction_limbs, 0);
+    double magnitude = std::fabs(value);
+    for (size_t i = 0; i < _limbs.size() && magnitude > 0; i++)
+    {
+        double limb = std::floor(magnitude);
+        _limbs[i] = (uint32_t)limb;
+        magnitude = std::ldexp(magnitude - limb, 32);
+    }
+}
+
+
+bool Fixed_Real::parse(const std::string& text,
+                       unsigned int fraction_limbs,
+                       Fixed_Real* out)
+{
+    // Read a plain decimal number such as -0.7436438870371587047521915
+    size_t pos = 0;
+    bool negative = false;
+    if (pos < text.size() && (text[pos] == '-' || text[pos] == '+'))
+        negative = text[pos++] == '-';
+    uint64_t integer = 0;
+    size_t digits = 0;
+    while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9')
+    {
+        integer = integer * 10 + (text[pos++] - '0');
+        digits++;
+        if (integer > 0xFFFFFFFFu)
+            return false;
+    }
+    std::string fraction;
+    if (pos < text.size() && text[pos] == '.')
+    {
+        pos++;
+        while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9')
+            fraction += text[pos++];
+    }
+    if (pos != text.size() || digits + fraction.size() == 0)
+        return false;
+
+    // Build the fraction from its last digit up: x = (digit + x) / 10,
+    //   dividing every limb in turn like long division
+    Fixed_Real result;
+    result._limbs.assign(1 + fraction_limbs, 0);
+    for (size_t i = fraction.size(); i-- > 0;)
+    {
+        result._limbs[0] = fraction[i] - '0';
+        uint64_t remainder = 0;
+        for (size_t j = 0; j < result._limbs.size(); j++)
+        {
+            uint64_t current = remainder << 32 | result._limbs[j];
+            result._limbs[j] = (uint32_t)(current / 10);
+            remainder = current % 10;
+        }
+    }
+    result._limbs[0] = (uint32_t)integer;
+    result._negative = negative;
+    *out = result;
+    return true;
+}
+
+
+int Fixed_Real::compare_magnitude(const Fixed_Real& a, const Fixed_Real& b)
+{
+    size_t n = std::max(a._limbs.size(), b._limbs.size());
+    for (size_t i = 0; i < n; i++)
+    {
+        uint32_t x = i < a._limbs.size() ? a._limbs[i] : 0;
+        uint32_t y = i < b._limbs.size() ? b._limbs[i] : 0;
+        if (x != y)
+            return x < y ? -1 : 1;
+    }
+    return 0;
+}
+
+
+Fixed_Real Fixed_Real::add_magnitude(const Fixed_Real& a, const Fixed_Real& b,
+                                     bool negative)
+{
+    Fixed_Real result;
+    size_t n = std::max(a._limbs.size(), b._limbs.size());
+    result._limbs.assign(n, 0);
+    result._negative = negative;
+    uint64_t carry = 0;
+    for (size_t i = n; i-- > 0;)
+    {
+        uint64_t sum = carry;
+        sum += i < a._limbs.size() ? a._limbs[i] : 0;
+        sum += i < b._limbs.size() ? b._limbs[i] : 0;
+        result._limbs[i] = (uint32_t)sum;
+        carry = sum >> 32;
+    }
+    return result;
+}
+
+
+Fixed_Real Fixed_Real::subtract_magnitude(const Fixed_Real& a,
+                                          const Fixed_Real& b,
+                                          bool negative)
+{
+    // |a| - |b|, for |a| >= |b|
+    Fixed_Real result;
+    size_t n = std::max(a._limbs.size(), b._limbs.size());
+    result._limbs.assign(n, 0);
+    result._negative = negative;
+    int64_t borrow = 0;
+    for (size_t i = n; i-- > 0;)
+    {
+        int64_t difference = -borrow;
+        difference += i < a._limbs.size() ? a._limbs[i] : 0;
+        difference -= i < b._limbs.size() ? b._limbs[i] : 0;
+        borrow = difference < 0 ? 1 : 0;
+        result._limbs[i] = (uint32_t)(difference + (borrow << 32));
+    }
+    return result;
+}
+
+
+Fixed_Real Fixed_Real::operator+(const Fixed_Real& b) const
+{
+    if (_negative == b._negative)
+        return add_magnitude(*this, b, _negative);
+    if (compare_magnitude(*this, b) >= 0)
+        return subtract_magnitude(*this, b, _negative);
+    return subtract_magnitude(b, *this, b._negative);
+}
+
+
+Fixed_Real Fixed_Real::operator-(const Fixed_Real& b) const
+{
+    Fixed_Real negated = b;
+    negated._negative = !b._negative;
+    return *this + negated;
+}
+
+
+Fixed_Real Fixed_Real::operator*(const Fixed_Real& b) const
+{
+    // Schoolbook product, truncated to the larger number of fraction limbs.
+    //   Column k of the product has weight 2^(-32 k)
+    size_t n = std::max(_limbs.size(), b._limbs.size());
+    std::vector<uint64_t> columns(_limbs.size() + b._limbs.size(), 0);
+    std::vector<uint64_t> carries(columns.size(), 0);
+    for (size_t i = 0; i < _limbs.size(); i++)
+    {
+        for (size_t j = 0; j < b._limbs.size(); j++)
+        {
+            uint64_t product = (uint64_t)_limbs[i] * b._limbs[j];
+            // Split so columns can't overflow: low half here, high half
+            //   one column up
+            columns[i + j] += product & 0xFFFFFFFFu;
+            if (i + j > 0)
+                carries[i + j - 1] += product >> 32;
+        }
+    }
+    Fixed_Real result;
+    result._limbs.assign(n, 0);
+    result._negative = _negative != b._negative;
+    uint64_t carry = 0;
+    for (size_t k = columns.size(); k-- > 0;)
+    {
+        uint64_t sum = columns[k] + carries[k] + carry;
+        if (k < n)
+            result._limbs[k] = (uint32_t)sum;
+        carry = sum >> 32;
+    }
+    // Integer parts of 2^32 and beyond are lost, which the escape radius
+    //   keeps reference orbits far away from
+    return result;
+}
+
+
+double Fixed_Real::to_double(void) const
+{
+    double value = 0.0;
+    for (size_t i = _limbs.size(); i-- > 0;)
+        value = value / 4294967296.0 + _limbs[i];
+    return _negative ? -value : value;
+}
+
+
+unsigned int Fixed_Real::fraction_limbs(void) const
+{
+    return (unsigned int)_limbs.size() - 1;
+}
+
+
+unsigned int fraction_limbs_for(double pixel_size)
+{
+    double bits = -std::log2(pixel_size) + 64.0;
+    return std::max(2u, (unsigned int)std::ceil(bits / 32.0));
+}
@@ -0,0 +1,46 @@
+//  multiprecision.hpp
+//
+//  Header file for a signed fixed point real number with any number of
+//   32-bit fraction limbs, precise enough to hold the center of a deep
+//   zoom and its reference orbit
+
+
+#ifndef MULTIPRECISION_H
+#define MULTIPRECISION_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+class Fixed_Real
+{
+    public:
+        Fixed_Real(void);
+        Fixed_Real(double value, unsigned int fraction_limbs);
+        static bool parse(const std::string& text,
+                          unsigned int fraction_limbs,
+                          Fixed_Real* out);
+        Fixed_Real operator+(const Fixed_Real& b) const;
+        Fixed_Real operator-(const Fixed_Real& b) const;
+        Fixed_Real operator*(const Fixed_Real& b) const;
+        double to_double(void) const;
+        unsigned int fraction_limbs(void) const;
+    private:
+        static int compare_magnitude(const Fixed_Real& a, const Fixed_Real& b);
+        static Fixed_Real add_magnitude(const Fixed_Real& a,
+                                        const Fixed_Real& b,
+                                        bool negative);
+        static Fixed_Real subtract_magnitude(const Fixed_Real& a,
+                                             const Fixed_Real& b,
+                                             bool negative);
+        bool _negative;
+        // _limbs[0] is the integer part, then the fraction limbs from the
+        //   most significant: the magnitude is sum(_limbs[i] * 2^(-32 i))
+        std::vector<uint32_t> _limbs;
+};
+
+// Fraction limbs needed to resolve pixels of the given size with 64 bits
+//   to spare for the error growth of a reference orbit
+unsigned int fraction_limbs_for(double pixel_size);
+
+#endif // MULTIPRECISION_H
@@ -0,0 +1,245 @@
+//  qoi.cpp
+//
+//  Source code for the QOI encoder and decoder, following the QOI
+//   specification version 1.0
+
+
+#include "qoi.hpp"
+
+static const uint8_t QOI_OP_INDEX = 0x00; // 00xxxxxx
+static const uint8_t QOI_OP_DIFF = 0x40;  // 01xxxxxx
+static const uint8_t QOI_OP_LUMA = 0x80;  // 10xxxxxx
+static const uint8_t QOI_OP_RUN = 0xC0;   // 11xxxxxx
+static const uint8_t QOI_OP_RGB = 0xFE;
+static const uint8_t QOI_OP_RGBA = 0xFF;
+static const uint8_t QOI_MASK_2 = 0xC0;
+static const unsigned int QOI_HEADER_SIZE = 14;
+static const unsigned int QOI_MAX_RUN = 62;
+// Files end with seven 0x00 bytes and one 0x01 byte
+static const uint8_t QOI_PADDING[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+// Refuse images larger than this many pixels when decoding
+static const uint64_t QOI_MAX_PIXELS = 400000000;
+
+
+struct QOI_Pixel
+{
+    uint8_t r, g, b, a;
+};
+
+
+static unsigned int qoi_hash(const QOI_Pixel& px)
+{
+    return (px.r * 3 + px.g * 5 + px.b * 7 + px.a * 11) % 64;
+}
+
+
+static bool qoi_equal(const QOI_Pixel& p, const QOI_Pixel& q)
+{
+    return p.r == q.r && p.g == q.g && p.b == q.b && p.a == q.a;
+}
+
+
+static void put_u32(unsigned char* out, uint32_t value)
+{
+    // QOI stores header values in big endian byte order
+    out[0] = (unsigned char)(value >> 24);
+    out[1] = (unsigned char)(value >> 16);
+    out[2] = (unsigned char)(value >> 8);
+    out[3] = (unsigned char)(value);
+}
+
+
+static uint32_t get_u32(const unsigned char* in)
+{
+    return (uint32_t)in[0] << 24 | (uint32_t)in[1] << 16 |
+           (uint32_t)in[2] << 8 | (uint32_t)in[3];
+}
+
+
+bool qoi_encode(const uint8_t* pixels,
+                unsigned int width,
+                unsigned int height,
+                unsigned int channels,
+                std::vector<unsigned char>* out)
+{
+    if (width == 0 || height == 0 || (channels != 3 && channels != 4))
+        return false;
+
+    // Reserve the worst case (every pixel a QOI_OP_RGBA) so the loop can
+    //   write through a plain pointer
+    size_t num_pixels = (size_t)width * height;
+    out->resize(QOI_HEADER_SIZE + num_pixels * (channels + 1) +
+                sizeof(QOI_PADDING));
+    unsigned char* bytes = &(*out)[0];
+    size_t p = 0;
+    bytes[p++] = 'q';
+    bytes[p++] = 'o';
+    bytes[p++] = 'i';
+    bytes[p++] = 'f';
+    put_u32(bytes + p, width);
+    put_u32(bytes + p + 4, height);
+    p += 8;
+    bytes[p++] = (unsigned char)channels;
+    bytes[p++] = 0; // sRGB with linear alpha
+
+    QOI_Pixel index[64] = {};
+    QOI_Pixel prev = {0, 0, 0, 255};
+    QOI_Pixel px = prev;
+    unsigned int run = 0;
+    const uint8_t* src = pixels;
+    const uint8_t* end = pixels + num_pixels * channels;
+    for (; src < end; src += channels)
+    {
+        px.r = src[0];
+        px.g = src[1];
+        px.b = src[2];
+        if (channels == 4)
+            px.a = src[3];
+
+        // Runs of the previous pixel cover the flat regions of a frame
+        if (qoi_equal(px, prev))
+        {
+            run++;
+            if (run == QOI_MAX_RUN || src + channels == end)
+            {
+                bytes[p++] = QOI_OP_RUN | (run - 1);
+                run = 0;
+            }
+            continue;
+        }
+        if (run > 0)
+        {
+            bytes[p++] = QOI_OP_RUN | (run - 1);
+            run = 0;
+        }
+
+        // Then a recently seen pixel, a small difference from the previous
+        //   one, or the full color
+        unsigned int index_pos = qoi_hash(px);
+        if (qoi_equal(index[index_pos], px))
+            bytes[p++] = QOI_OP_INDEX | index_pos;
+        else
+        {
+            index[index_pos] = px;
+            if (px.a == prev.a)
+            {
+                int8_t vr = px.r - prev.r;
+                int8_t vg = px.g - prev.g;
+                int8_t vb = px.b - prev.b;
+                int8_t vg_r = vr - vg;
+                int8_t vg_b = vb - vg;
+                if (vr > -3 && vr < 2 && vg > -3 && vg < 2 &&
+                    vb > -3 && vb < 2)
+                    bytes[p++] = QOI_OP_DIFF | (vr + 2) << 4 |
+                                 (vg + 2) << 2 | (vb + 2);
+                else if (vg_r > -9 && vg_r < 8 && vg > -33 && vg < 32 &&
+                         vg_b > -9 && vg_b < 8)
+                {
+                    bytes[p++] = QOI_OP_LUMA | (vg + 32);
+                    bytes[p++] = (vg_r + 8) << 4 | (vg_b + 8);
+                }
+                else
+                {
+                    bytes[p++] = QOI_OP_RGB;
+                    bytes[p++] = px.r;
+                    bytes[p++] = px.g;
+                    bytes[p++] = px.b;
+                }
+            }
+            else
+            {
+                bytes[p++] = QOI_OP_RGBA;
+                bytes[p++] = px.r;
+                bytes[p++] = px.g;
+                bytes[p++] = px.b;
+                bytes[p++] = px.a;
+            }
+        }
+        prev = px;
+    }
+    for (unsigned int i = 0; i < sizeof(QOI_PADDING); i++)
+        bytes[p++] = QOI_PADDING[i];
+    out->resize(p);
+    return true;
+}
+
+
+bool qoi_decode(const std::vector<unsigned char>& data,
+                unsigned int* width,
+                unsigned int* height,
+                unsigned int* channels,
+                std::vector<unsigned char>* pixels)
+{
+    // Check the header
+    if (data.size() < QOI_HEADER_SIZE + sizeof(QOI_PADDING))
+        return false;
+    const unsigned char* bytes = &data[0];
+    if (bytes[0] != 'q' || bytes[1] != 'o' || bytes[2] != 'i' ||
+        bytes[3] != 'f')
+        return false;
+    *width = get_u32(bytes + 4);
+    *height = get_u32(bytes + 8);
+    *channels = bytes[12];
+    if (*width == 0 || *height == 0 || (*channels != 3 && *channels != 4) ||
+        bytes[13] > 1 || (uint64_t)*width * *height > QOI_MAX_PIXELS)
+        return false;
+
+    size_t num_pixels = (size_t)*width * *height;
+    pixels->resize(num_pixels * *channels);
+    unsigned char* dst = &(*pixels)[0];
+    QOI_Pixel index[64] = {};
+    QOI_Pixel px = {0, 0, 0, 255};
+    unsigned int run = 0;
+    size_t p = QOI_HEADER_SIZE;
+    size_t chunks_end = data.size() - sizeof(QOI_PADDING);
+    for (size_t i = 0; i < num_pixels; i++)
+    {
+        if (run > 0)
+            run--;
+        else if (p < chunks_end)
+        {
+            uint8_t b1 = bytes[p++];
+            if (b1 == QOI_OP_RGB)
+            {
+                px.r = bytes[p++];
+                px.g = bytes[p++];
+                px.b = bytes[p++];
+            }
+            else if (b1 == QOI_OP_RGBA)
+            {
+                px.r = bytes[p++];
+                px.g = bytes[p++];
+                px.b = bytes[p++];
+                px.a = bytes[p++];
+            }
+            else if ((b1 & QOI_MASK_2) == QOI_OP_INDEX)
+                px = index[b1];
+            else if ((b1 & QOI_MASK_2) == QOI_OP_DIFF)
+            {
+                px.r += ((b1 >> 4) & 0x03) - 2;
+                px.g += ((b1 >> 2) & 0x03) - 2;
+                px.b += (b1 & 0x03) - 2;
+            }
+            else if ((b1 & QOI_MASK_2) == QOI_OP_LUMA)
+            {
+                uint8_t b2 = bytes[p++];
+                int vg = (b1 & 0x3F) - 32;
+                px.r += vg - 8 + ((b2 >> 4) & 0x0F);
+                px.g += vg;
+                px.b += vg - 8 + (b2 & 0x0F);
+            }
+            else
+                run = b1 & 0x3F;
+            index[qoi_hash(px)] = px;
+        }
+        else
+            return false; // ran out of chunks
+        dst[0] = px.r;
+        dst[1] = px.g;
+        dst[2] = px.b;
+        if (*channels == 4)
+            dst[3] = px.a;
+        dst += *channels;
+    }
+    return true;
+}
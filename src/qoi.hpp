@@ -0,0 +1,31 @@
+//  qoi.hpp
+//
+//  Header file for the QOI ("Quite OK Image") encoder and decoder, a fast
+//   lossless format for scratch frames: much smaller than PPM, and much
+//   faster to write than PNG
+
+
+#ifndef QOI_H
+#define QOI_H
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+// Encode width * height pixels with 3 (RGB) or 4 (RGBA) bytes each into a
+//   complete QOI file
+bool qoi_encode(const uint8_t* pixels,
+                unsigned int width,
+                unsigned int height,
+                unsigned int channels,
+                std::vector<unsigned char>* out);
+
+// Decode a complete QOI file to pixels with the number of channels stored
+//   in its header, returns false if the data is not a valid QOI file
+bool qoi_decode(const std::vector<unsigned char>& data,
+                unsigned int* width,
+                unsigned int* height,
+                unsigned int* channels,
+                std::vector<unsigned char>* pixels);
+
+#endif // QOI_H
@@ -0,0 +1,35 @@
+//  reference_orbit.cpp
+//
+//  Source code for reference orbit functions
+
+
+#include <cmath>
+#include "reference_orbit.hpp"
+
+
+void reference_orbit(const Fixed_Real& z_re, const Fixed_Real& z_im,
+                     float c_re, float c_im,
+                     std::vector<double>* orbit)
+{
+    unsigned int limbs = z_re.fraction_limbs();
+    Fixed_Real re = z_re;
+    Fixed_Real im = z_im;
+    Fixed_Real cr(c_re, limbs);
+    Fixed_Real ci(c_im, limbs);
+    orbit->clear();
+    for (unsigned int depth = 255; ; depth--)
+    {
+        double x = re.to_double();
+        double y = im.to_double();
+        orbit->push_back(x);
+        orbit->push_back(y);
+        // Same escape test as julia_depth, with the magnitude as a float
+        if (!((float)std::sqrt(x * x + y * y) < 1000) || depth < 1)
+            break;
+        Fixed_Real re2 = re * re;
+        Fixed_Real im2 = im * im;
+        Fixed_Real cross = re * im;
+        im = cross + cross + ci;
+        re = re2 - im2 + cr;
+    }
+}
@@ -0,0 +1,21 @@
+//  reference_orbit.hpp
+//
+//  Header file for reference orbits of deep zooms, computed with enough
+//   precision to keep the zoom center, so the device only iterates each
+//   pixel's small offset from them in double precision
+
+
+#ifndef REFERENCE_ORBIT_H
+#define REFERENCE_ORBIT_H
+
+#include <vector>
+#include "multiprecision.hpp"
+
+// Orbit of z under z^2 + c rounded to doubles and stored as interleaved
+//   re, im pairs, up to and including the first point julia_depth would
+//   count as escaped (at most 256 points)
+void reference_orbit(const Fixed_Real& z_re, const Fixed_Real& z_im,
+                     float c_re, float c_im,
+                     std::vector<double>* orbit);
+
+#endif // REFERENCE_ORBIT_H
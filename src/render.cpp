@@ -11,36 +11,312 @@
 #include <sstream>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <unistd.h>
 #include <time.h>
 #include <iomanip>
 #include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <cmath>
+#include <algorithm>
+#include <chrono>
+#include <thread>
 #include "lodepng.h"
 #include "opencl_errors.hpp"
 #include "julia_set.hpp"
+#include "field_archive.hpp"
+#include "reference_orbit.hpp"
+#include "device_profile.hpp"
+#include "escape_probe.hpp"
+#include "frame_scheduler.hpp"
+
+// OpenCL objects and settings of one of the devices --all-devices renders
+//   frames on, set up like the single device of other runs
+struct Render_Device
+{
+    cl::Device device;
+    cl::Context context;
+    cl::CommandQueue queue;
+    cl::Program program;
+    cl::Buffer buffer_re;
+    cl::Buffer buffer_im;
+    cl::Buffer cmap_buf;
+    Variant_Buffers shared;
+    Device_Profile profile;
+    Kernel_Variant variant;
+    bool point;         // grid mirrored for z -> -z symmetry
+    bool im_mirrored;   // imaginary axis mirrored for z -> conj(z)
+};
 
 // Function prototypes
 cl_uint4* colormap(std::string filename, unsigned int* size);
-cl::Platform get_platform(void);
-cl::Device get_device(cl::Platform* platform);
+std::vector<unsigned char> depth_palette(cl_uint4* cmap,
+                                         unsigned int cmap_size);
+cl::Device get_device(const std::string& choice, size_t size,
+                      float center_re, float center_im, float zoom,
+                      float c_re, float c_im);
+double device_score(cl::Device* device, size_t size, float center_re,
+                    float center_im, float zoom, float c_re, float c_im);
+std::string lowercase(std::string text);
 cl::Context get_context(cl::Device* device);
+std::vector<cl::Device> usable_devices(void);
 cl::Program build_program(std::string source_file, cl::Context* context,
                           cl::Device* device);
 void check_device_info(cl::Device* device);
+cl::Buffer depth_levels(cl::Context* context);
+bool same_depths_as_double(Kernel_Variant variant, cl::Context* context,
+                           cl::CommandQueue* queue, cl::Program* program,
+                           cl::Kernel* spaced_re_kernel,
+                           cl::Kernel* spaced_im_kernel,
+                           cl::Buffer* buffer_re, cl::Buffer* buffer_im,
+                           Variant_Buffers* shared, size_t size, float c_re,
+                           float c_im);
+Kernel_Variant choose_image_variant(bool has_fp64, cl::Context* context,
+                                    cl::CommandQueue* queue,
+                                    cl::Program* program,
+                                    cl::Kernel* spaced_re_kernel,
+                                    cl::Kernel* spaced_im_kernel,
+                                    cl::Buffer* buffer_re,
+                                    cl::Buffer* buffer_im,
+                                    Variant_Buffers* shared,
+                                    size_t size, float c_re, float c_im);
+void tune_launch(Kernel_Variant variant, cl::Device* device,
+                 cl::Context* context, cl::CommandQueue* queue,
+                 cl::Program* program, cl::Buffer* buffer_re,
+                 cl::Buffer* buffer_im, cl::Buffer* cmap_buf,
+                 unsigned int cmap_size, Variant_Buffers* shared,
+                 size_t size, float c_re, float c_im,
+                 Device_Profile* profile);
+void create_variant_buffers(cl::Context* context, cl::CommandQueue* queue,
+                            size_t size, Variant_Buffers* shared);
+Kernel_Variant profiled_variant(bool has_fp64, cl::Device* device,
+                                cl::Context* context,
+                                cl::CommandQueue* queue,
+                                cl::Program* program,
+                                cl::Kernel* spaced_re_kernel,
+                                cl::Kernel* spaced_im_kernel,
+                                cl::Buffer* buffer_re, cl::Buffer* buffer_im,
+                                cl::Buffer* cmap_buf, unsigned int cmap_size,
+                                Variant_Buffers* shared, size_t size,
+                                float c_re, float c_im, bool profiled,
+                                const std::string& profile_path,
+                                Device_Profile* profile);
+double time_frames(Julia_Set* probes, unsigned int count,
+                   cl::CommandQueue* queue, unsigned int batch_frames,
+                   unsigned int flush_frames);
+size_t render_split_frames(std::vector<Julia_Set>* frames,
+                           cl::CommandQueue* queue, size_t size,
+                           const std::vector<float>& spaced_re,
+                           const std::vector<float>& spaced_im,
+                           const cl_uint4* cmap);
+const char* variant_name(Kernel_Variant variant);
+Kernel_Variant frame_variant(double extent, double pixel_size,
+                             Kernel_Variant fast_variant, bool has_fp64,
+                             bool deep);
+int render_all_devices(size_t size, const std::string& cmap_filename,
+                       const std::string& output_format,
+                       unsigned int num_frames, float center_re,
+                       float center_im, float zoom, float c_re, float c_im,
+                       float c_re_step, float c_im_step, unsigned int fps,
+                       bool verify);
+void render_on_device(Render_Device* device, unsigned int index,
+                      Frame_Scheduler* scheduler,
+                      std::vector<Julia_Set>* frames,
+                      const std::vector<Attracting_Cycle>* cycles,
+                      cl::ImageFormat* format, unsigned int cmap_size,
+                      size_t size, float c_re, float c_im, float c_re_step,
+                      float c_im_step);
+unsigned int coherent_key_frame(unsigned int i, unsigned int num_frames);
+bool is_mirrored(const std::vector<float>& values);
+void recolor_frame(const uint8_t* depths, const uint32_t* lut, size_t count,
+                   uint8_t* rgba);
+void write_ppm(std::string filename, const uint8_t* rgba, size_t size);
+bool export_color_frames(std::vector<Julia_Set>* frames,
+                         const std::string& output_format,
+                         const std::vector<unsigned char>& palette,
+                         size_t size, unsigned int fps, bool verify,
+                         time_t* t_s);
+void make_mp4(unsigned int fps);
+int recolor(int argc, char** argv);
 std::string ts(time_t* start_time);
+void print_usage(void);
 
 
 int main(int argc, char** argv)
 {
+    // Recoloring an iteration field archive doesn't render anything
+    if (argc > 1 && std::string(argv[1]) == "recolor")
+        return recolor(argc, argv);
+
     // Parse arguments
-    if (argc != 3)
+    if (argc < 3)
     {
-        std::cerr << "Error: Incomplete arguments" << std::endl
-                  << "Usage: ./render.o <video size in px> <colormap png>"
-                  << std::endl;
+        std::cerr << "Error: Incomplete arguments" << std::endl;
+        print_usage();
         return EXIT_FAILURE;
     }
     size_t size = (size_t)atoi(argv[1]);
     std::string cmap_filename = argv[2];
+    std::string output_format = "mp4";
+    bool cycle = false;
+    bool incremental = false;
+    bool vectorize = false;
+    bool adaptive = false;
+    bool all_devices = false;
+    bool split = false;
+    bool verify = false;
+    // Device by index, part of its name or "auto", from the environment
+    //   unless an option gives it
+    std::string device_choice;
+    bool device_option = false;
+    if (getenv("RENDER_DEVICE") != NULL)
+        device_choice = getenv("RENDER_DEVICE");
+    double unresolved = PROBE_UNRESOLVED;
+    bool deep = false;
+    std::string deep_re;
+    std::string deep_im;
+    double deep_zoom = 0.0;
+    double deep_factor = 1.0;
+    for (int i = 3; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg.compare(0, 9, "--format=") == 0)
+            output_format = arg.substr(9);
+        else if (arg == "--cycle")
+            cycle = true;
+        else if (arg == "--incremental")
+            incremental = true;
+        else if (arg == "--vectorize")
+            vectorize = true;
+        else if (arg == "--adaptive")
+            adaptive = true;
+        else if (arg == "--all-devices")
+            all_devices = true;
+        else if (arg == "--split")
+            split = true;
+        else if (arg == "--verify")
+            verify = true;
+        else if (arg.compare(0, 9, "--device=") == 0)
+        {
+            device_choice = arg.substr(9);
+            device_option = true;
+        }
+        else if (arg.compare(0, 11, "--adaptive=") == 0)
+        {
+            adaptive = true;
+            unresolved = atof(arg.substr(11).c_str());
+            if (!(unresolved >= 0.0 && unresolved < 1.0))
+            {
+                std::cerr << "Error: Invalid unresolved fraction " << arg
+                          << std::endl;
+                print_usage();
+                return EXIT_FAILURE;
+            }
+        }
+        else if (arg.compare(0, 7, "--deep=") == 0)
+        {
+            // Center coordinates stay strings until the precision they
+            //   need is known, zoom and zoom factor are plain doubles
+            std::vector<std::string> fields;
+            std::stringstream ss(arg.substr(7));
+            std::string field;
+            while (std::getline(ss, field, ','))
+                fields.push_back(field);
+            if (fields.size() == 3 || fields.size() == 4)
+            {
+                deep_re = fields[0];
+                deep_im = fields[1];
+                deep_zoom = atof(fields[2].c_str());
+                if (fields.size() == 4)
+                    deep_factor = atof(fields[3].c_str());
+            }
+            deep = deep_zoom > 0.0 && deep_factor > 0.0;
+            if (!deep)
+            {
+                std::cerr << "Error: Invalid deep zoom " << arg << std::endl;
+                print_usage();
+                return EXIT_FAILURE;
+            }
+        }
+        else
+        {
+            std::cerr << "Error: Unknown option " << arg << std::endl;
+            print_usage();
+            return EXIT_FAILURE;
+        }
+    }
+    if (output_format != "mp4" && output_format != "apng" &&
+        output_format != "gif" && output_format != "qoi" &&
+        output_format != "field")
+    {
+        std::cerr << "Error: Unknown output format " << output_format
+                  << std::endl;
+        print_usage();
+        return EXIT_FAILURE;
+    }
+    if (cycle && (output_format == "gif" || output_format == "field"))
+    {
+        std::cerr << "Error: --cycle needs a color output format" << std::endl;
+        print_usage();
+        return EXIT_FAILURE;
+    }
+    if (incremental && (cycle || output_format == "gif" ||
+                        output_format == "field"))
+    {
+        std::cerr << "Error: --incremental needs a color output format "
+                  << "without --cycle" << std::endl;
+        print_usage();
+        return EXIT_FAILURE;
+    }
+    if (vectorize && (cycle || incremental || output_format == "gif" ||
+                      output_format == "field"))
+    {
+        std::cerr << "Error: --vectorize needs a color output format "
+                  << "without --cycle or --incremental" << std::endl;
+        print_usage();
+        return EXIT_FAILURE;
+    }
+    if (deep && (cycle || incremental || vectorize ||
+                 output_format == "gif" || output_format == "field"))
+    {
+        std::cerr << "Error: --deep needs a color output format without "
+                  << "--cycle, --incremental or --vectorize" << std::endl;
+        print_usage();
+        return EXIT_FAILURE;
+    }
+    if (adaptive && (cycle || incremental || vectorize || deep ||
+                     output_format == "gif" || output_format == "field"))
+    {
+        std::cerr << "Error: --adaptive needs a color output format without "
+                  << "--cycle, --incremental, --vectorize or --deep"
+                  << std::endl;
+        print_usage();
+        return EXIT_FAILURE;
+    }
+    if (all_devices && (cycle || incremental || vectorize || adaptive ||
+                        deep || device_option || output_format == "gif" ||
+                        output_format == "field"))
+    {
+        std::cerr << "Error: --all-devices needs a color output format "
+                  << "without other options" << std::endl;
+        print_usage();
+        return EXIT_FAILURE;
+    }
+    if (split && (cycle || incremental || vectorize || adaptive || deep ||
+                  all_devices || output_format == "gif" ||
+                  output_format == "field"))
+    {
+        std::cerr << "Error: --split needs a color output format without "
+                  << "other options" << std::endl;
+        print_usage();
+        return EXIT_FAILURE;
+    }
+    if (verify && output_format != "qoi")
+    {
+        std::cerr << "Error: --verify needs --format=qoi" << std::endl;
+        print_usage();
+        return EXIT_FAILURE;
+    }
    
     // Define parameters for fractal animation 
     unsigned int num_frames = 600;
@@ -51,6 +327,16 @@ int main(int argc, char** argv)
     float c_im = 0.635;
     float c_re_step = 0.0;
     float c_im_step = 0.00002;
+    unsigned int fps = 60;
+    // GIF frames and field archives store depths, the other formats colors
+    bool depth_output = output_format == "gif" || output_format == "field";
+
+    // Render plain frames on every device at once
+    if (all_devices)
+        return render_all_devices(size, cmap_filename, output_format,
+                                  num_frames, center_re, center_im, zoom,
+                                  c_re, c_im, c_re_step, c_im_step, fps,
+                                  verify);
 
     // Declare OpenCL objects
     cl_int err = CL_SUCCESS;
@@ -61,16 +347,41 @@ int main(int argc, char** argv)
 
     // Initialize OpenCL platform layer
     // ===============================================================
-    // Create OpenCL platform
-    platform = get_platform();
-    // Create OpenCL device
-    device = get_device(&platform);
+    // Create OpenCL device, from any platform
+    device = get_device(device_choice, size, center_re, center_im, zoom,
+                        c_re, c_im);
+    // Get its OpenCL platform
+    platform = cl::Platform(device.getInfo<CL_DEVICE_PLATFORM>());
+    std::cout << "\tUsing platform " << platform.getInfo<CL_PLATFORM_NAME>()
+              << std::endl;
     // Create OpenCL context 
     context = get_context(&device);
     // Create OpenCL command queue
-    queue = cl::CommandQueue(context, device);
+    // Split frames time the device's share with the profiling info of
+    //   their render kernel
+    queue = cl::CommandQueue(context, device,
+                             split ? CL_QUEUE_PROFILING_ENABLE : 0);
     // Check device information for image support and dimensions
     check_device_info(&device);
+    // Only plain frames have a kernel for devices without double precision
+    bool has_fp64 = device.getInfo<CL_DEVICE_DOUBLE_FP_CONFIG>() != 0;
+    if (!has_fp64 && (cycle || incremental || vectorize || adaptive ||
+                      deep || split || depth_output))
+    {
+        std::cerr << "Error: OpenCL device has no double precision, which "
+                  << "all options except --format=mp4|apng|qoi need"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+    // Launch shape and arithmetic that were fastest on this device and
+    //   driver, from its profile if an earlier run benchmarked them
+    std::string device_name = device.getInfo<CL_DEVICE_NAME>().c_str();
+    std::string driver_version = device.getInfo<CL_DRIVER_VERSION>().c_str();
+    Device_Profile profile;
+    device_profile_init(&profile, device_name, driver_version);
+    std::string profile_path = device_profile_path(device_name,
+                                                   driver_version);
+    bool profiled = load_device_profile(profile_path, &profile);
 
     // Create buffers
     // ===============================================================
@@ -109,27 +420,274 @@ int main(int argc, char** argv)
     // ===============================================================
     // Build kernel program from source
     cl::Program program = build_program("src/kernel.cl", &context, &device);
-    // Create kernels for julia set objects 
-    for (unsigned int i = 0; i < num_frames; i++)
-        frames[i].create_kernel(&program,
-                                "render_image",
-                                &buffer_re,
-                                &buffer_im,
-                                &cmap_buf,
-                                cmap_size,
-                                c_re + i * c_re_step,
-                                c_im + i * c_im_step);
     // Create kernels for real & imaginary value buffers
+    // Only renders that may mirror pixels need a grid that is exactly
+    //   symmetric around 0, the others keep the grid from its minimum
+    bool try_symmetry = !incremental && !cycle && !vectorize && !deep &&
+                        !depth_output && !split;
     cl::Kernel spaced_re_kernel(program, "even_re");
     spaced_re_kernel.setArg(0, center_re);
     spaced_re_kernel.setArg(1, zoom);
     spaced_re_kernel.setArg(2, (float)size);
-    spaced_re_kernel.setArg(3, buffer_re);
+    spaced_re_kernel.setArg(3, (cl_int)(try_symmetry && center_re == 0.0f));
+    spaced_re_kernel.setArg(4, buffer_re);
     cl::Kernel spaced_im_kernel(program, "even_im");
     spaced_im_kernel.setArg(0, center_im);
     spaced_im_kernel.setArg(1, zoom);
     spaced_im_kernel.setArg(2, (float)size);
-    spaced_im_kernel.setArg(3, buffer_im);
+    spaced_im_kernel.setArg(3, (cl_int)(try_symmetry && center_im == 0.0f));
+    spaced_im_kernel.setArg(4, buffer_im);
+    // In palette cycling mode, the julia set of the first frame is only
+    //   computed once, as depths which every frame colors with a rotated
+    //   colormap (one full rotation over the animation)
+    Julia_Set field;
+    if (cycle)
+    {
+        Attracting_Cycle attracting;
+        find_attracting_cycle(c_re, c_im, &attracting);
+        field = Julia_Set(size, &image_format, &context);
+        field.create_depth_kernel(&program, &buffer_re, &buffer_im, c_re,
+                                  c_im, attracting);
+    }
+    // In incremental mode, frames are rendered in groups of three around a
+    //   key frame, which certifies the pixels whose depth can't change
+    //   between its c and the c of the other two frames
+    cl::Buffer coherent_depths;
+    cl::Buffer coherent_certified;
+    if (incremental)
+    {
+        coherent_depths = cl::Buffer(context, CL_MEM_READ_WRITE, size * size);
+        coherent_certified = cl::Buffer(context, CL_MEM_READ_WRITE,
+                                        size * size);
+    }
+    // Frames are viewed around a center with as many digits as the deepest
+    //   frame needs, in case it has to be rendered by perturbation. The
+    //   zoom is multiplied by zoom_factor every frame (only for --deep)
+    double first_zoom = deep ? deep_zoom : zoom;
+    double zoom_factor = deep ? deep_factor : 1.0;
+    double smallest = std::min(first_zoom, first_zoom *
+                               pow(zoom_factor, num_frames - 1)) / size;
+    unsigned int limbs = fraction_limbs_for(smallest);
+    Fixed_Real view_re(center_re, limbs);
+    Fixed_Real view_im(center_im, limbs);
+    if (deep && (!Fixed_Real::parse(deep_re, limbs, &view_re) ||
+                 !Fixed_Real::parse(deep_im, limbs, &view_im)))
+    {
+        std::cerr << "Error: Deep zoom center must be decimal numbers"
+                  << std::endl;
+        print_usage();
+        return EXIT_FAILURE;
+    }
+    double view_extent = std::max(fabs(view_re.to_double()),
+                                  fabs(view_im.to_double()));
+    // Deep zoom frames rendered without perturbation get their own grids
+    std::vector<cl::Buffer> frame_grids;
+    if (deep)
+        frame_grids.resize(2 * num_frames);
+    // Plain frames use float-float arithmetic, or a float pass that leaves
+    //   only the pixels it can't certify to double precision, when the
+    //   device doesn't have double precision or runs them faster. The
+    //   variant and launch shape are benchmarked once per device and size
+    Kernel_Variant image_variant = KERNEL_DOUBLE;
+    Variant_Buffers shared;
+    if (!incremental && !cycle && !vectorize && !depth_output)
+    {
+        if (has_fp64)
+            create_variant_buffers(&context, &queue, size, &shared);
+        image_variant = profiled_variant(has_fp64, &device, &context, &queue,
+                                         &program, &spaced_re_kernel,
+                                         &spaced_im_kernel, &buffer_re,
+                                         &buffer_im, &cmap_buf, cmap_size,
+                                         &shared, size, c_re, c_im,
+                                         profiled, profile_path, &profile);
+        // Per-frame iteration limits need the passes of the resumable
+        //   variant, whatever arithmetic is fastest at the full limit
+        if (adaptive)
+            image_variant = KERNEL_RESUMABLE;
+        // Splitting frames with the host needs kernels that render the
+        //   rows they are launched over, with the double arithmetic of the
+        //   host's rows so both parts round alike
+        if (split)
+            image_variant = KERNEL_DOUBLE;
+    }
+    // Create kernels for julia set objects. Frames whose c has an attracting
+    //   cycle stop iterating interior pixels once they get close to it
+    unsigned int cycle_frames = 0;
+    std::vector<unsigned int> variant_frames(KERNEL_VARIANTS, 0);
+    std::vector<Attracting_Cycle> frame_cycles(num_frames);
+    for (unsigned int i = 0; i < num_frames; i++)
+    {
+        float frame_c_re = c_re + i * c_re_step;
+        float frame_c_im = c_im + i * c_im_step;
+        Attracting_Cycle attracting;
+        if (!incremental && !cycle && !vectorize &&
+            find_attracting_cycle(frame_c_re, frame_c_im, &attracting))
+            cycle_frames++;
+        frame_cycles[i] = attracting;
+        if (incremental)
+        {
+            unsigned int key = coherent_key_frame(i, num_frames);
+            double radius = 0.0;
+            if (i == key)
+            {
+                // Largest c distance from the key frame within its group,
+                //   using the same float values as the kernel arguments
+                for (unsigned int j = key - key % 3;
+                     j < num_frames && j / 3 == key / 3; j++)
+                {
+                    double d_re = (double)(c_re + j * c_re_step) -
+                                  (double)(c_re + key * c_re_step);
+                    double d_im = (double)(c_im + j * c_im_step) -
+                                  (double)(c_im + key * c_im_step);
+                    radius = std::max(radius,
+                                      sqrt(d_re * d_re + d_im * d_im));
+                }
+                radius *= 1.0 + 1e-9;
+            }
+            frames[i].create_coherent_kernel(&program,
+                                             &buffer_re,
+                                             &buffer_im,
+                                             &coherent_depths,
+                                             &coherent_certified,
+                                             &cmap_buf,
+                                             cmap_size,
+                                             frame_c_re,
+                                             frame_c_im,
+                                             radius,
+                                             i == key);
+        }
+        else if (cycle)
+            frames[i].create_cycle_kernel(&program,
+                                          field.depth_buffer(),
+                                          &cmap_buf,
+                                          cmap_size,
+                                          (unsigned long)i * cmap_size /
+                                          num_frames);
+        else if (depth_output)
+            frames[i].create_depth_kernel(&program,
+                                          &buffer_re,
+                                          &buffer_im,
+                                          frame_c_re,
+                                          frame_c_im,
+                                          attracting);
+        else if (vectorize)
+        {
+            // The first frame of every four renders all four
+            if (i % 4 == 0)
+            {
+                unsigned int count = std::min(4u, num_frames - i);
+                float group_c_re[4];
+                float group_c_im[4];
+                for (unsigned int k = 0; k < count; k++)
+                {
+                    group_c_re[k] = c_re + (i + k) * c_re_step;
+                    group_c_im[k] = c_im + (i + k) * c_im_step;
+                }
+                frames[i].create_vector_kernel(&program,
+                                               &frames[i],
+                                               count,
+                                               &buffer_re,
+                                               &buffer_im,
+                                               &cmap_buf,
+                                               cmap_size,
+                                               group_c_re,
+                                               group_c_im);
+            }
+        }
+        else
+        {
+            // Each frame uses the cheapest arithmetic that can still tell
+            //   its pixels apart
+            double frame_zoom = first_zoom * pow(zoom_factor, i);
+            Kernel_Variant variant = frame_variant(view_extent +
+                                                   frame_zoom / 2.0,
+                                                   frame_zoom / size,
+                                                   image_variant, has_fp64,
+                                                   deep);
+            variant_frames[variant]++;
+            if (variant == KERNEL_PERTURBED)
+            {
+                // Orbits of the view center and of 0, which the pixels of
+                //   the frame iterate their offsets from
+                Fixed_Real zero(0.0, limbs);
+                std::vector<double> reference;
+                std::vector<double> critical;
+                reference_orbit(view_re, view_im, frame_c_re, frame_c_im,
+                                &reference);
+                reference_orbit(zero, zero, frame_c_re, frame_c_im,
+                                &critical);
+                frames[i].create_perturbed_kernel(&program,
+                                                  reference,
+                                                  critical,
+                                                  &cmap_buf,
+                                                  cmap_size,
+                                                  frame_zoom / size);
+                frames[i].set_launch_shape(profile.local_width,
+                                           profile.local_height, 1);
+                continue;
+            }
+            cl::Buffer* frame_re = &buffer_re;
+            cl::Buffer* frame_im = &buffer_im;
+            if (deep)
+            {
+                frame_re = &frame_grids[2 * i];
+                frame_im = &frame_grids[2 * i + 1];
+                *frame_re = cl::Buffer(context, CL_MEM_READ_WRITE,
+                                       sizeof(float) * size);
+                *frame_im = cl::Buffer(context, CL_MEM_READ_WRITE,
+                                       sizeof(float) * size);
+                cl::Kernel grid_re_kernel(program, "even_re");
+                grid_re_kernel.setArg(0, (float)view_re.to_double());
+                grid_re_kernel.setArg(1, (float)frame_zoom);
+                grid_re_kernel.setArg(2, (float)size);
+                grid_re_kernel.setArg(3, (cl_int)0);
+                grid_re_kernel.setArg(4, *frame_re);
+                cl::Kernel grid_im_kernel(program, "even_im");
+                grid_im_kernel.setArg(0, (float)view_im.to_double());
+                grid_im_kernel.setArg(1, (float)frame_zoom);
+                grid_im_kernel.setArg(2, (float)size);
+                grid_im_kernel.setArg(3, (cl_int)0);
+                grid_im_kernel.setArg(4, *frame_im);
+                queue.enqueueTask(grid_re_kernel);
+                queue.enqueueTask(grid_im_kernel);
+            }
+            frames[i].create_kernel(&program,
+                                    variant,
+                                    frame_re,
+                                    frame_im,
+                                    &cmap_buf,
+                                    cmap_size,
+                                    frame_c_re,
+                                    frame_c_im,
+                                    attracting,
+                                    &shared);
+            frames[i].set_launch_shape(profile.local_width,
+                                       profile.local_height, profile.strip);
+        }
+    }
+    if (cycle_frames > 0)
+        std::cout << "Found attracting cycles for " << cycle_frames << " of "
+                  << num_frames << " frames" << std::endl;
+    unsigned int other_frames = 0;
+    for (unsigned int v = 0; v < KERNEL_VARIANTS; v++)
+    {
+        if (v != KERNEL_DOUBLE)
+            other_frames += variant_frames[v];
+    }
+    if (other_frames > 0)
+    {
+        std::cout << "Precision per frame: ";
+        const char* separator = "";
+        for (unsigned int v = 0; v < KERNEL_VARIANTS; v++)
+        {
+            if (variant_frames[v] == 0)
+                continue;
+            std::cout << separator << variant_frames[v] << " "
+                      << variant_name((Kernel_Variant)v);
+            separator = ", ";
+        }
+        std::cout << std::endl;
+    }
    
      
     // Start OpenCL operations
@@ -158,13 +716,106 @@ int main(int argc, char** argv)
     err = queue.finish();
     std::cout << ts(&t_s) << "Computed evenly spaced real and imaginary values"
               << std::endl;
+
+    // Limit the iterations of each frame to what a probe of it needs
+    // ===============================================================
+    // The host probes frames, and checks symmetries, on the same grid
+    std::vector<float> spaced_re(size);
+    std::vector<float> spaced_im(size);
+    if (!incremental && !cycle && !vectorize && !deep && !depth_output)
+    {
+        queue.enqueueReadBuffer(buffer_re, CL_TRUE, 0, sizeof(float) * size,
+                                &spaced_re[0]);
+        queue.enqueueReadBuffer(buffer_im, CL_TRUE, 0, sizeof(float) * size,
+                                &spaced_im[0]);
+    }
+    // Symmetry below depends on the limits, and frames that take it go back
+    //   to the full limit
+    if (adaptive)
+    {
+        for (unsigned int i = 0; i < num_frames; i++)
+            frames[i].set_iteration_limit(
+                probe_iteration_limit(spaced_re, spaced_im,
+                                      c_re + i * c_re_step,
+                                      c_im + i * c_im_step, frame_cycles[i],
+                                      unresolved));
+    }
+
+    // Compute only part of symmetric julia sets
+    // ===============================================================
+    if (try_symmetry)
+    {
+        // z -> -z symmetry needs both axes of the grid to be mirrored
+        //   exactly, z -> conj(z) only the imaginary one and a real c
+        bool im_mirrored = is_mirrored(spaced_im);
+        bool point = im_mirrored && is_mirrored(spaced_re);
+        unsigned int symmetric_frames = 0;
+        for (unsigned int i = 0; i < num_frames; i++)
+        {
+            float frame_c_im = c_im + i * c_im_step;
+            bool conjugate = im_mirrored && frame_c_im == 0.0f;
+            if ((point || conjugate) &&
+                frames[i].use_symmetry(&program, point, conjugate))
+                symmetric_frames++;
+        }
+        if (symmetric_frames > 0)
+            std::cout << ts(&t_s) << "Using symmetry for " << symmetric_frames
+                      << " of " << num_frames << " frames" << std::endl;
+    }
+    if (adaptive)
+    {
+        // Limits the frames render with, after symmetry
+        unsigned int lowest = 255;
+        unsigned int highest = 0;
+        unsigned long total = 0;
+        for (unsigned int i = 0; i < num_frames; i++)
+        {
+            unsigned int limit = frames[i].iteration_limit();
+            lowest = std::min(lowest, limit);
+            highest = std::max(highest, limit);
+            total += limit;
+        }
+        std::cout << ts(&t_s) << "Probes limited iterations per frame to "
+                  << lowest << " to " << highest << " (mean "
+                  << total / num_frames << ")" << std::endl;
+    }
     
     // Compute julia sets
     // ===============================================================
-    for (unsigned int i = 0; i < num_frames; i++)
-        frames[i].queue_kernel(&queue);
+    if (cycle)
+        field.queue_kernel(&queue);
+    size_t host_total = 0;
+    if (split)
+        host_total = render_split_frames(&frames, &queue, size, spaced_re,
+                                         spaced_im, cmap);
+    for (unsigned int i = 0; i < num_frames && !split; i++)
+    {
+        // The in-order queue runs each key frame before the rest of its
+        //   group, and the whole group before the next key frame
+        unsigned int frame = i;
+        if (incremental)
+        {
+            unsigned int key = coherent_key_frame(i, num_frames);
+            unsigned int first = key - key % 3;
+            if (i == first)
+                frame = key;
+            else if (i <= key)
+                frame = i - 1;
+        }
+        frames[frame].queue_kernel(&queue);
+        // Hand the queued frames to the device and wait for them as often
+        //   as the device profile says was fastest
+        if (profile.flush_frames > 0 && (i + 1) % profile.flush_frames == 0)
+            queue.flush();
+        if (profile.batch_frames > 0 && (i + 1) % profile.batch_frames == 0)
+            queue.finish();
+    }
     err = queue.finish();
     std::cout << ts(&t_s) << "Computed julia sets" << std::endl;
+    if (split)
+        std::cout << ts(&t_s) << "Host rendered "
+                  << 100.0 * host_total / ((double)size * num_frames)
+                  << "% of the rows" << std::endl;
 
     if (err != CL_SUCCESS)
     {
@@ -176,24 +827,58 @@ int main(int argc, char** argv)
     // Read julia sets to host memory and export
     // ===============================================================
     for (unsigned int i = 0; i < num_frames; i++)
-        frames[i].read_image_to_host(&queue);
+    {
+        if (depth_output)
+            frames[i].read_depth_to_host(&queue);
+        else
+            frames[i].read_image_to_host(&queue);
+    }
     err = queue.finish();
     std::cout << ts(&t_s) << "Finished reading julia sets to host memory" 
               << std::endl;
-    // Create directory to hold rendered frames
-    struct stat st = {0};
-    if (stat("./frames/", &st) == -1)
-        mkdir("./frames/", 0700);
-    // Export julia set images to PPM files 
-    char ppm_buf[100];
-    for (unsigned int i = 0; i < num_frames; i++)
+    if (output_format == "gif")
     {
-        snprintf(ppm_buf, sizeof(ppm_buf), "./frames/F%04d.ppm", i);
-        frames[i].export_to_ppm(ppm_buf);
+        // Export julia set depths as the frames of one animated GIF file
+        GIF_Writer gif("out.gif", size, num_frames, fps,
+                       depth_palette(cmap, cmap_size));
+        for (unsigned int i = 0; i < num_frames; i++)
+            frames[i].export_to_gif(&gif);
+        std::cout << ts(&t_s) << "Finished exporting julia sets to out.gif"
+                  << std::endl;
+    }
+    else if (output_format == "field")
+    {
+        // Export julia set depths with the animation parameters to an
+        //   iteration field archive, which "./render recolor" can color
+        Field_Header header;
+        field_header_init(&header);
+        header.size = size;
+        header.num_frames = num_frames;
+        header.fps = fps;
+        header.center_re = center_re;
+        header.center_im = center_im;
+        header.zoom = zoom;
+        header.c_re = c_re;
+        header.c_im = c_im;
+        header.c_re_step = c_re_step;
+        header.c_im_step = c_im_step;
+        Field_Archive_Writer archive("out.jfa", header);
+        for (unsigned int i = 0; i < num_frames; i++)
+            frames[i].export_to_archive(&archive);
+        std::cout << ts(&t_s) << "Finished exporting julia sets to out.jfa"
+                  << std::endl;
+    }
+    else
+    {
+        // Cycled colormaps give colors outside the depth palette, so those
+        //   APNG frames are stored as RGB
+        std::vector<unsigned char> palette;
+        if (!cycle)
+            palette = depth_palette(cmap, cmap_size);
+        if (!export_color_frames(&frames, output_format, palette, size, fps,
+                                 verify, &t_s))
+            return EXIT_FAILURE;
     }
-    err = queue.finish();
-    std::cout << ts(&t_s) << "Finished exporting julia sets to PPM files" 
-              << std::endl;
 
     // Cleanup resources
     // ===============================================================
@@ -201,49 +886,449 @@ int main(int argc, char** argv)
 
     // Create MP4 video from PPM image frames
     // ===============================================================
-    std::string mp4_system_call = "ffmpeg -f image2 -r 60 -i ";
-    mp4_system_call += "frames/F%04d.ppm -vcodec mpeg4 -q:v 20 -c:v libx264 ";
-    mp4_system_call += "-y out.mp4";
-    system(mp4_system_call.c_str());
+    if (output_format == "mp4")
+        make_mp4(fps);
 
     return EXIT_SUCCESS;
 }
 
 
-cl::Platform get_platform(void)
+int render_all_devices(size_t size, const std::string& cmap_filename,
+                       const std::string& output_format,
+                       unsigned int num_frames, float center_re,
+                       float center_im, float zoom, float c_re, float c_im,
+                       float c_re_step, float c_im_step, unsigned int fps,
+                       bool verify)
 {
-    // Get all available OpenCL platforms
-    std::vector<cl::Platform> all_platforms;
-    cl::Platform::get(&all_platforms);
-    if (all_platforms.size() == 0)
+    // Set up every device that can render images, on every platform, with
+    //   its own grid, colormap and the variant and launch shape of its
+    //   profile (benchmarked first if there is none)
+    std::vector<cl::Device> found = usable_devices();
+    if (found.empty())
     {
-        std::cerr << "No OpenCL platforms found... exiting" << std::endl;
-        exit(EXIT_FAILURE);
+        std::cerr << "No OpenCL devices with image support found... exiting"
+                  << std::endl;
+        return EXIT_FAILURE;
     }
-    // Print number of available platforms to stdout
-    else if (all_platforms.size() > 1)
-        std::cout << "Found " << all_platforms.size() << " available"
-                  << " OpenCL platforms" << std::endl;
-    else
-        std::cout << "Found 1 available OpenCL platform" << std::endl;
-    cl::Platform platform = all_platforms[0];
-    std::cout << "\tUsing platform " << platform.getInfo<CL_PLATFORM_NAME>()
+    unsigned int cmap_size;
+    cl_uint4* cmap = colormap(cmap_filename, &cmap_size);
+    if (cmap == NULL) return EXIT_FAILURE;
+    double extent = std::max(fabs(center_re), fabs(center_im)) + zoom / 2.0;
+    std::vector<Render_Device> devices(found.size());
+    std::vector<double> scores(found.size());
+    for (unsigned int d = 0; d < devices.size(); d++)
+    {
+        Render_Device* device = &devices[d];
+        device->device = found[d];
+        std::string device_name =
+            device->device.getInfo<CL_DEVICE_NAME>().c_str();
+        std::string driver_version =
+            device->device.getInfo<CL_DRIVER_VERSION>().c_str();
+        std::cout << "Setting up device [" << d << "] " << device_name
+                  << std::endl;
+        device->context = get_context(&device->device);
+        device->queue = cl::CommandQueue(device->context, device->device);
+        device->program = build_program("src/kernel.cl", &device->context,
+                                        &device->device);
+        device->buffer_re = cl::Buffer(device->context, CL_MEM_READ_WRITE,
+                                       sizeof(float) * size);
+        device->buffer_im = cl::Buffer(device->context, CL_MEM_READ_WRITE,
+                                       sizeof(float) * size);
+        device->cmap_buf = cl::Buffer(device->context,
+                                      CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                      sizeof(cl_uint4) * cmap_size, cmap);
+        cl::Kernel spaced_re_kernel(device->program, "even_re");
+        spaced_re_kernel.setArg(0, center_re);
+        spaced_re_kernel.setArg(1, zoom);
+        spaced_re_kernel.setArg(2, (float)size);
+        spaced_re_kernel.setArg(3, (cl_int)(center_re == 0.0f));
+        spaced_re_kernel.setArg(4, device->buffer_re);
+        cl::Kernel spaced_im_kernel(device->program, "even_im");
+        spaced_im_kernel.setArg(0, center_im);
+        spaced_im_kernel.setArg(1, zoom);
+        spaced_im_kernel.setArg(2, (float)size);
+        spaced_im_kernel.setArg(3, (cl_int)(center_im == 0.0f));
+        spaced_im_kernel.setArg(4, device->buffer_im);
+        bool has_fp64 =
+            device->device.getInfo<CL_DEVICE_DOUBLE_FP_CONFIG>() != 0;
+        if (has_fp64)
+            create_variant_buffers(&device->context, &device->queue, size,
+                                   &device->shared);
+        device_profile_init(&device->profile, device_name, driver_version);
+        std::string profile_path = device_profile_path(device_name,
+                                                       driver_version);
+        bool profiled = load_device_profile(profile_path, &device->profile);
+        Kernel_Variant variant = profiled_variant(has_fp64, &device->device,
+                                                  &device->context,
+                                                  &device->queue,
+                                                  &device->program,
+                                                  &spaced_re_kernel,
+                                                  &spaced_im_kernel,
+                                                  &device->buffer_re,
+                                                  &device->buffer_im,
+                                                  &device->cmap_buf,
+                                                  cmap_size, &device->shared,
+                                                  size, c_re, c_im, profiled,
+                                                  profile_path,
+                                                  &device->profile);
+        device->variant = frame_variant(extent, zoom / size, variant,
+                                        has_fp64, false);
+        // Symmetries of the grid, which every device computes itself
+        std::vector<float> spaced_re(size);
+        std::vector<float> spaced_im(size);
+        device->queue.enqueueTask(spaced_re_kernel);
+        device->queue.enqueueTask(spaced_im_kernel);
+        device->queue.enqueueReadBuffer(device->buffer_re, CL_TRUE, 0,
+                                        sizeof(float) * size, &spaced_re[0]);
+        device->queue.enqueueReadBuffer(device->buffer_im, CL_TRUE, 0,
+                                        sizeof(float) * size, &spaced_im[0]);
+        device->im_mirrored = is_mirrored(spaced_im);
+        device->point = device->im_mirrored && is_mirrored(spaced_re);
+        scores[d] = device_score(&device->device, size, center_re,
+                                 center_im, zoom, c_re, c_im);
+    }
+    std::vector<Attracting_Cycle> cycles(num_frames);
+    for (unsigned int i = 0; i < num_frames; i++)
+        find_attracting_cycle(c_re + i * c_re_step, c_im + i * c_im_step,
+                              &cycles[i]);
+
+    // One host thread per device takes frames from the scheduler until
+    //   they are all rendered, each into the Julia_Set of its frame number
+    std::cout << "STARTING EXECUTION" << std::endl;
+    time_t t_s = time(0);
+    cl::ImageFormat image_format(CL_RGBA, CL_UNSIGNED_INT8);
+    std::vector<Julia_Set> frames(num_frames);
+    Frame_Scheduler scheduler(num_frames, devices.size());
+    // Weigh the devices by their scores until they have been timed
+    for (unsigned int d = 0; d < devices.size(); d++)
+        scheduler.estimate(d, scores[d]);
+    std::vector<std::thread> threads;
+    for (unsigned int d = 0; d < devices.size(); d++)
+        threads.push_back(std::thread(render_on_device, &devices[d], d,
+                                      &scheduler, &frames, &cycles,
+                                      &image_format, cmap_size, size, c_re,
+                                      c_im, c_re_step, c_im_step));
+    for (unsigned int d = 0; d < threads.size(); d++)
+        threads[d].join();
+    std::cout << ts(&t_s) << "Computed julia sets" << std::endl;
+    for (unsigned int d = 0; d < devices.size(); d++)
+        std::cout << "\t[" << d << "] "
+                  << devices[d].device.getInfo<CL_DEVICE_NAME>() << ": "
+                  << scheduler.frames_rendered(d) << " frames, "
+                  << scheduler.frame_seconds(d) * 1000.0 << " ms per frame"
+                  << std::endl;
+
+    if (!export_color_frames(&frames, output_format,
+                             depth_palette(cmap, cmap_size), size, fps, verify,
+                             &t_s))
+        return EXIT_FAILURE;
+    if (output_format == "mp4")
+        make_mp4(fps);
+    return EXIT_SUCCESS;
+}
+
+
+void render_on_device(Render_Device* device, unsigned int index,
+                      Frame_Scheduler* scheduler,
+                      std::vector<Julia_Set>* frames,
+                      const std::vector<Attracting_Cycle>* cycles,
+                      cl::ImageFormat* format, unsigned int cmap_size,
+                      size_t size, float c_re, float c_im, float c_re_step,
+                      float c_im_step)
+{
+    // Render the frames the scheduler hands this device and read them to
+    //   host memory before taking more, which times the device
+    unsigned int first;
+    unsigned int count;
+    while (scheduler->take_frames(index, &first, &count))
+    {
+        std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+        for (unsigned int i = first; i < first + count; i++)
+        {
+            float frame_c_re = c_re + i * c_re_step;
+            float frame_c_im = c_im + i * c_im_step;
+            Julia_Set* frame = &(*frames)[i];
+            *frame = Julia_Set(size, format, &device->context);
+            frame->create_kernel(&device->program,
+                                 device->variant,
+                                 &device->buffer_re,
+                                 &device->buffer_im,
+                                 &device->cmap_buf,
+                                 cmap_size,
+                                 frame_c_re,
+                                 frame_c_im,
+                                 (*cycles)[i],
+                                 &device->shared);
+            frame->set_launch_shape(device->profile.local_width,
+                                    device->profile.local_height,
+                                    device->profile.strip);
+            bool conjugate = device->im_mirrored && frame_c_im == 0.0f;
+            if (device->point || conjugate)
+                frame->use_symmetry(&device->program, device->point,
+                                    conjugate);
+            frame->queue_kernel(&device->queue);
+            if (device->profile.flush_frames > 0 &&
+                (i - first + 1) % device->profile.flush_frames == 0)
+                device->queue.flush();
+        }
+        for (unsigned int i = first; i < first + count; i++)
+            (*frames)[i].read_image_to_host(&device->queue);
+        scheduler->report(index, count, std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+}
+
+
+unsigned int coherent_key_frame(unsigned int i, unsigned int num_frames)
+{
+    // Key frame of the incremental rendering group of frame i: the middle
+    //   of frames 3n to 3n + 2, or the last frame of a shorter last group
+    return std::min(i - i % 3 + 1, num_frames - 1);
+}
+
+
+bool is_mirrored(const std::vector<float>& values)
+{
+    // Whether evenly spaced values are exactly symmetric around 0, so that
+    //   pixel size - i is the mirror of pixel i
+    size_t n = values.size();
+    for (size_t i = 1; i < n; i++)
+    {
+        if (values[n - i] != -values[i])
+            return false;
+    }
+    return n > 1;
+}
+
+
+int recolor(int argc, char** argv)
+{
+    // Parse arguments
+    if (argc < 4)
+    {
+        std::cerr << "Error: Incomplete arguments" << std::endl;
+        print_usage();
+        return EXIT_FAILURE;
+    }
+    std::string archive_filename = argv[2];
+    std::string cmap_filename = argv[3];
+    std::string output_format = "mp4";
+    for (int i = 4; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg.compare(0, 9, "--format=") == 0)
+            output_format = arg.substr(9);
+        else
+        {
+            std::cerr << "Error: Unknown option " << arg << std::endl;
+            print_usage();
+            return EXIT_FAILURE;
+        }
+    }
+    if (output_format != "mp4" && output_format != "apng" &&
+        output_format != "gif" && output_format != "qoi")
+    {
+        std::cerr << "Error: Unknown recolor output format " << output_format
+                  << std::endl;
+        print_usage();
+        return EXIT_FAILURE;
+    }
+
+    // Map the archive and build the depth to color table
+    Field_Archive archive;
+    if (!archive.open(archive_filename))
+        return EXIT_FAILURE;
+    const Field_Header& header = archive.header();
+    size_t size = header.size;
+    unsigned int num_frames = header.num_frames;
+    unsigned int cmap_size;
+    cl_uint4* cmap = colormap(cmap_filename, &cmap_size);
+    if (cmap == NULL) return EXIT_FAILURE;
+    std::vector<unsigned char> palette = depth_palette(cmap, cmap_size);
+    delete[] cmap;
+    uint32_t lut[256];
+    memcpy(lut, &palette[0], sizeof(lut));
+
+    std::cout << "Recoloring " << num_frames << " frames of " << size << "x"
+              << size << " pixels" << std::endl;
+    time_t t_s = time(0);
+    if (output_format == "gif")
+    {
+        // The depths are already GIF palette indices
+        GIF_Writer gif("out.gif", size, num_frames, header.fps, palette);
+        for (unsigned int i = 0; i < num_frames; i++)
+            gif.add_frame(archive.frame(i));
+        std::cout << ts(&t_s) << "Finished exporting frames to out.gif"
+                  << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    std::vector<uint8_t> rgba(size * size * 4);
+    if (output_format == "apng")
+    {
+        APNG_Writer apng("out.png", size, num_frames, header.fps, palette);
+        for (unsigned int i = 0; i < num_frames; i++)
+        {
+            recolor_frame(archive.frame(i), lut, size * size, &rgba[0]);
+            if (!apng.add_frame(&rgba[0]))
+                return EXIT_FAILURE;
+        }
+        std::cout << ts(&t_s) << "Finished exporting frames to out.png"
+                  << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    struct stat st = {0};
+    if (stat("./frames/", &st) == -1)
+        mkdir("./frames/", 0700);
+    char frame_buf[100];
+    std::vector<unsigned char> qoi;
+    for (unsigned int i = 0; i < num_frames; i++)
+    {
+        recolor_frame(archive.frame(i), lut, size * size, &rgba[0]);
+        if (output_format == "qoi")
+        {
+            snprintf(frame_buf, sizeof(frame_buf), "./frames/F%04d.qoi", i);
+            if (!qoi_encode(&rgba[0], size, size, 4, &qoi))
+            {
+                std::cerr << "Image encoding error: invalid QOI image size"
+                          << std::endl;
+                return EXIT_FAILURE;
+            }
+            std::ofstream ofs(frame_buf, std::ios::binary);
+            ofs.write((const char*)&qoi[0], qoi.size());
+            if (!ofs)
+            {
+                std::cerr << "Could not write " << frame_buf << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        else
+        {
+            snprintf(frame_buf, sizeof(frame_buf), "./frames/F%04d.ppm", i);
+            write_ppm(frame_buf, &rgba[0], size);
+        }
+    }
+    std::cout << ts(&t_s) << "Finished exporting frames to "
+              << (output_format == "qoi" ? "QOI" : "PPM") << " files"
               << std::endl;
-    return platform;
+    if (output_format == "mp4")
+        make_mp4(header.fps);
+    return EXIT_SUCCESS;
+}
+
+
+void recolor_frame(const uint8_t* depths, const uint32_t* lut, size_t count,
+                   uint8_t* rgba)
+{
+    // Look up each depth's RGBA color as one 32-bit word. The 1 KB table
+    //   stays in L1 cache, so this runs at about the speed of a copy
+    uint32_t* out = (uint32_t*)rgba;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        out[i + 0] = lut[depths[i + 0]];
+        out[i + 1] = lut[depths[i + 1]];
+        out[i + 2] = lut[depths[i + 2]];
+        out[i + 3] = lut[depths[i + 3]];
+    }
+    for (; i < count; i++)
+        out[i] = lut[depths[i]];
+}
+
+
+void write_ppm(std::string filename, const uint8_t* rgba, size_t size)
+{
+    // Write the RGB channels of an RGBA image to a PPM file
+    std::vector<unsigned char> rgb(size * size * 3);
+    for (size_t i = 0; i < size * size; i++)
+    {
+        rgb[i * 3 + 0] = rgba[i * 4 + 0];
+        rgb[i * 3 + 1] = rgba[i * 4 + 1];
+        rgb[i * 3 + 2] = rgba[i * 4 + 2];
+    }
+    std::ofstream ofs;
+    ofs.open(filename.c_str(), std::ios::binary);
+    ofs << "P6\n" << size << " " << size << "\n255\n";
+    ofs.write((const char*)&rgb[0], rgb.size());
+    ofs.close();
+}
+
+
+bool export_color_frames(std::vector<Julia_Set>* frames,
+                         const std::string& output_format,
+                         const std::vector<unsigned char>& palette,
+                         size_t size, unsigned int fps, bool verify,
+                         time_t* t_s)
+{
+    unsigned int num_frames = frames->size();
+    if (output_format == "apng")
+    {
+        // Export julia set images as the frames of one animated PNG file
+        APNG_Writer apng("out.png", size, num_frames, fps, palette);
+        for (unsigned int i = 0; i < num_frames; i++)
+            if (!(*frames)[i].export_to_apng(&apng))
+                return false;
+        std::cout << ts(t_s) << "Finished exporting julia sets to out.png"
+                  << std::endl;
+        return true;
+    }
+    // Create directory to hold rendered frames
+    struct stat st = {0};
+    if (stat("./frames/", &st) == -1)
+        mkdir("./frames/", 0700);
+    // Export julia set images to PPM files for ffmpeg, or to QOI files
+    //   when only the frames are wanted, decoding each again to check it
+    //   when verifying
+    char frame_buf[100];
+    for (unsigned int i = 0; i < num_frames; i++)
+    {
+        if (output_format == "qoi")
+        {
+            snprintf(frame_buf, sizeof(frame_buf), "./frames/F%04d.qoi", i);
+            if (!(*frames)[i].export_to_qoi(frame_buf, verify) && verify)
+                return false;
+        }
+        else
+        {
+            snprintf(frame_buf, sizeof(frame_buf), "./frames/F%04d.ppm", i);
+            (*frames)[i].export_to_ppm(frame_buf);
+        }
+    }
+    std::cout << ts(t_s) << "Finished exporting julia sets to "
+              << (output_format == "qoi" ? "QOI" : "PPM") << " files"
+              << (verify ? ", all decoding to the rendered images" : "")
+              << std::endl;
+    return true;
+}
+
+
+void make_mp4(unsigned int fps)
+{
+    // Create MP4 video from the PPM image frames with ffmpeg
+    std::string mp4_system_call = "ffmpeg -f image2 -r ";
+    mp4_system_call += std::to_string(fps) + " -i ";
+    mp4_system_call += "frames/F%04d.ppm -vcodec mpeg4 -q:v 20 ";
+    mp4_system_call += "-c:v libx264 -y out.mp4";
+    system(mp4_system_call.c_str());
 }
 
 
-cl::Device get_device(cl::Platform* platform)
+cl::Device get_device(const std::string& choice, size_t size,
+                      float center_re, float center_im, float zoom,
+                      float c_re, float c_im)
 {
-    // Get list of all OpenCL devices on platform
-    std::vector<cl::Device> all_devices;
-    platform->getDevices(CL_DEVICE_TYPE_ALL, &all_devices);
+    // Get list of all OpenCL devices on every platform
+    std::vector<cl::Device> all_devices = usable_devices();
     if (all_devices.size() == 0)
     {
         std::cerr << "No OpenCL devices found... exiting" << std::endl;
         exit(EXIT_FAILURE);
     }
-    // Let user choose OpenCL device if more than 1 is avialable
+    // Let user choose OpenCL device if more than 1 is avialable and there
+    //   is no choice already, or choose the fastest when nobody can answer
+    std::string policy = choice;
     unsigned int device_num = 0;
     if (all_devices.size() > 1)
     {
@@ -254,13 +1339,65 @@ cl::Device get_device(cl::Platform* platform)
                       << all_devices[i].getInfo<CL_DEVICE_NAME>()
                       << std::endl;
         }
-        std::cout << "Device preference: ";
-        std::cin >> device_num;
+        if (policy.empty() && !isatty(fileno(stdin)))
+            policy = "auto";
+        if (policy.empty())
+        {
+            std::cout << "Device preference: ";
+            std::cin >> device_num;
+        }
+        else if (policy == "auto")
+        {
+            // Time a plain frame on every device, or take the time from
+            //   its profile
+            double fastest = 0.0;
+            for (unsigned int i = 0; i < all_devices.size(); i++)
+            {
+                double seconds = device_score(&all_devices[i], size,
+                                              center_re, center_im, zoom,
+                                              c_re, c_im);
+                std::cout << "\t[" << i << "] " << seconds * 1000.0
+                          << " ms per frame" << std::endl;
+                if (i == 0 || seconds < fastest)
+                {
+                    fastest = seconds;
+                    device_num = i;
+                }
+            }
+        }
     }
     else
     {
         std::cout << "Found 1 available OpenCL device" << std::endl;
     }
+    if (!policy.empty() && policy != "auto")
+    {
+        // An index, or else the first device with the choice in its name,
+        //   ignoring case
+        char* end;
+        unsigned long index = strtoul(policy.c_str(), &end, 10);
+        device_num = all_devices.size();
+        if (*end == '\0')
+            device_num = std::min<unsigned long>(index, all_devices.size());
+        else
+        {
+            std::string wanted = lowercase(policy);
+            for (unsigned int i = 0; i < all_devices.size() &&
+                 device_num == all_devices.size(); i++)
+            {
+                std::string name = lowercase(
+                    all_devices[i].getInfo<CL_DEVICE_NAME>().c_str());
+                if (name.find(wanted) != std::string::npos)
+                    device_num = i;
+            }
+        }
+    }
+    if (device_num >= all_devices.size())
+    {
+        std::cerr << "No OpenCL device matches " << policy << "... exiting"
+                  << std::endl;
+        exit(EXIT_FAILURE);
+    }
     std::cout << "\tUsing device " 
               << all_devices[device_num].getInfo<CL_DEVICE_NAME>()
               << std::endl;
@@ -268,12 +1405,98 @@ cl::Device get_device(cl::Platform* platform)
 }
 
 
+std::string lowercase(std::string text)
+{
+    for (size_t i = 0; i < text.size(); i++)
+        text[i] = tolower((unsigned char)text[i]);
+    return text;
+}
+
+
+double device_score(cl::Device* device, size_t size, float center_re,
+                    float center_im, float zoom, float c_re, float c_im)
+{
+    // Seconds a device takes to render a plain frame of this size with
+    //   render_image (render_image_ff without double precision), kept in
+    //   its profile so later runs don't render it again
+    std::string device_name = device->getInfo<CL_DEVICE_NAME>().c_str();
+    std::string driver_version = device->getInfo<CL_DRIVER_VERSION>().c_str();
+    Device_Profile profile;
+    device_profile_init(&profile, device_name, driver_version);
+    std::string profile_path = device_profile_path(device_name,
+                                                   driver_version);
+    load_device_profile(profile_path, &profile);
+    if (profile.score_size == size && profile.score_seconds > 0.0)
+        return profile.score_seconds;
+
+    cl::Context context = get_context(device);
+    cl::CommandQueue queue(context, *device);
+    cl::Program program = build_program("src/kernel.cl", &context, device);
+    cl::Buffer buffer_re(context, CL_MEM_READ_WRITE, sizeof(float) * size);
+    cl::Buffer buffer_im(context, CL_MEM_READ_WRITE, sizeof(float) * size);
+    cl::Kernel spaced_re_kernel(program, "even_re");
+    spaced_re_kernel.setArg(0, center_re);
+    spaced_re_kernel.setArg(1, zoom);
+    spaced_re_kernel.setArg(2, (float)size);
+    spaced_re_kernel.setArg(3, (cl_int)0);
+    spaced_re_kernel.setArg(4, buffer_re);
+    cl::Kernel spaced_im_kernel(program, "even_im");
+    spaced_im_kernel.setArg(0, center_im);
+    spaced_im_kernel.setArg(1, zoom);
+    spaced_im_kernel.setArg(2, (float)size);
+    spaced_im_kernel.setArg(3, (cl_int)0);
+    spaced_im_kernel.setArg(4, buffer_im);
+    queue.enqueueTask(spaced_re_kernel);
+    queue.enqueueTask(spaced_im_kernel);
+    // The colors don't matter, a colormap of one gray is enough
+    cl_uint4 gray = {{128, 128, 128, 255}};
+    cl::Buffer cmap_buf(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                        sizeof(cl_uint4), &gray);
+    bool has_fp64 = device->getInfo<CL_DEVICE_DOUBLE_FP_CONFIG>() != 0;
+    Attracting_Cycle attracting;
+    find_attracting_cycle(c_re, c_im, &attracting);
+    cl::ImageFormat image_format(CL_RGBA, CL_UNSIGNED_INT8);
+    Julia_Set probe(size, &image_format, &context);
+    probe.create_kernel(&program,
+                        has_fp64 ? KERNEL_DOUBLE : KERNEL_FLOAT_FLOAT,
+                        &buffer_re, &buffer_im, &cmap_buf, 1, c_re, c_im,
+                        attracting);
+    // Time a frame after one that warms the device up
+    time_frames(&probe, 1, &queue, 0, 0);
+    profile.score_size = size;
+    profile.score_seconds = time_frames(&probe, 1, &queue, 0, 0);
+    save_device_profile(profile_path, profile);
+    return profile.score_seconds;
+}
+
+
 cl::Context get_context(cl::Device* device)
 {
     return cl::Context({*device});
 }
 
 
+std::vector<cl::Device> usable_devices(void)
+{
+    // Devices of every platform that are available and can write images
+    std::vector<cl::Platform> all_platforms;
+    cl::Platform::get(&all_platforms);
+    std::vector<cl::Device> usable;
+    for (unsigned int p = 0; p < all_platforms.size(); p++)
+    {
+        std::vector<cl::Device> devices;
+        all_platforms[p].getDevices(CL_DEVICE_TYPE_ALL, &devices);
+        for (unsigned int d = 0; d < devices.size(); d++)
+        {
+            if (devices[d].getInfo<CL_DEVICE_AVAILABLE>() &&
+                devices[d].getInfo<CL_DEVICE_IMAGE_SUPPORT>())
+                usable.push_back(devices[d]);
+        }
+    }
+    return usable;
+}
+
+
 cl::Program build_program(std::string source_file, cl::Context* context,
                           cl::Device* device)
 {
@@ -328,6 +1551,494 @@ void check_device_info(cl::Device* device)
 }
 
 
+cl::Buffer depth_levels(cl::Context* context)
+{
+    // Colormap of DEPTH_LEVELS entries taking depth k to (k, 0, 0, 255), so
+    //   the red channels of an image rendered with it are its depths
+    std::vector<cl_uint4> levels(DEPTH_LEVELS);
+    for (unsigned int k = 0; k < DEPTH_LEVELS; k++)
+    {
+        cl_uint4 level = {{k, 0, 0, 255}};
+        levels[k] = level;
+    }
+    return cl::Buffer(*context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                      sizeof(cl_uint4) * DEPTH_LEVELS, &levels[0]);
+}
+
+
+bool same_depths_as_double(Kernel_Variant variant, cl::Context* context,
+                           cl::CommandQueue* queue, cl::Program* program,
+                           cl::Kernel* spaced_re_kernel,
+                           cl::Kernel* spaced_im_kernel,
+                           cl::Buffer* buffer_re, cl::Buffer* buffer_im,
+                           Variant_Buffers* shared, size_t size, float c_re,
+                           float c_im)
+{
+    // Whether a frame of the variant has every depth of a double frame
+    //   on the grid, for a variant read from a profile that was compared
+    //   on another one
+    queue->enqueueTask(*spaced_re_kernel);
+    queue->enqueueTask(*spaced_im_kernel);
+    cl::ImageFormat image_format(CL_RGBA, CL_UNSIGNED_INT8);
+    Attracting_Cycle attracting;
+    find_attracting_cycle(c_re, c_im, &attracting);
+    cl::Buffer levels_buf = depth_levels(context);
+    Julia_Set probes[2];
+    Kernel_Variant variants[2] = {KERNEL_DOUBLE, variant};
+    for (unsigned int v = 0; v < 2; v++)
+    {
+        probes[v] = Julia_Set(size, &image_format, context);
+        probes[v].create_kernel(program, variants[v], buffer_re, buffer_im,
+                                &levels_buf, DEPTH_LEVELS, c_re, c_im,
+                                attracting, shared);
+        probes[v].queue_kernel(queue);
+        probes[v].read_image_to_host(queue);
+    }
+    return probes[0].image() == probes[1].image();
+}
+
+
+Kernel_Variant choose_image_variant(bool has_fp64, cl::Context* context,
+                                    cl::CommandQueue* queue,
+                                    cl::Program* program,
+                                    cl::Kernel* spaced_re_kernel,
+                                    cl::Kernel* spaced_im_kernel,
+                                    cl::Buffer* buffer_re,
+                                    cl::Buffer* buffer_im,
+                                    Variant_Buffers* shared,
+                                    size_t size, float c_re, float c_im)
+{
+    // Time a frame with each variant the device can run, after a run that
+    //   warms it up. Consumer GPUs often run double precision at 1/16 to
+    //   1/64 of the float rate, where the float variants are several times
+    //   faster, and some devices are much faster with integers. The
+    //   sorted variant's timed run is ordered by the depths of its warm-up
+    //   run, like a frame after a similar one. On devices with doubles,
+    //   a variant is only chosen if it computes every depth double does,
+    //   which the probes show by rendering with depth_levels
+    queue->enqueueTask(*spaced_re_kernel);
+    queue->enqueueTask(*spaced_im_kernel);
+    cl::ImageFormat image_format(CL_RGBA, CL_UNSIGNED_INT8);
+    Attracting_Cycle attracting;
+    find_attracting_cycle(c_re, c_im, &attracting);
+    std::vector<Kernel_Variant> variants;
+    if (has_fp64)
+    {
+        variants.push_back(KERNEL_DOUBLE);
+        variants.push_back(KERNEL_MIXED);
+        if (size % UNROLLED_LANES == 0)
+            variants.push_back(KERNEL_UNROLLED);
+        variants.push_back(KERNEL_PERSISTENT);
+        variants.push_back(KERNEL_SORTED);
+        variants.push_back(KERNEL_RESUMABLE);
+    }
+    variants.push_back(KERNEL_FLOAT_FLOAT);
+    variants.push_back(KERNEL_FIXED);
+    cl::Buffer levels_buf = depth_levels(context);
+    std::vector<uint8_t> double_image;
+    std::vector<double> seconds(variants.size());
+    std::vector<bool> matched(variants.size(), true);
+    int fastest = -1;
+    for (unsigned int v = 0; v < variants.size(); v++)
+    {
+        Julia_Set probe(size, &image_format, context);
+        probe.create_kernel(program, variants[v], buffer_re, buffer_im,
+                            &levels_buf, DEPTH_LEVELS, c_re, c_im,
+                            attracting, shared);
+        probe.queue_kernel(queue);
+        queue->finish();
+        std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+        probe.queue_kernel(queue);
+        queue->finish();
+        seconds[v] = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+        if (has_fp64)
+        {
+            probe.read_image_to_host(queue);
+            if (variants[v] == KERNEL_DOUBLE)
+                double_image = probe.image();
+            else
+                matched[v] = probe.image() == double_image;
+        }
+        if (matched[v] && (fastest < 0 || seconds[v] < seconds[fastest]))
+            fastest = v;
+    }
+    std::cout << "Using " << variant_name(variants[fastest])
+              << " arithmetic (";
+    for (unsigned int v = 0; v < variants.size(); v++)
+        std::cout << (v > 0 ? ", " : "") << variant_name(variants[v]) << " "
+                  << seconds[v] * 1000.0 << " ms"
+                  << (matched[v] ? "" : " with depths unlike double's");
+    std::cout << " per frame)" << std::endl;
+    return variants[fastest];
+}
+
+
+void tune_launch(Kernel_Variant variant, cl::Device* device,
+                 cl::Context* context, cl::CommandQueue* queue,
+                 cl::Program* program, cl::Buffer* buffer_re,
+                 cl::Buffer* buffer_im, cl::Buffer* cmap_buf,
+                 unsigned int cmap_size, Variant_Buffers* shared,
+                 size_t size, float c_re, float c_im,
+                 Device_Profile* profile)
+{
+    // Time a centered crop of the first frame, at most TUNE_SIZE pixels a
+    //   side, with launch shapes that divide both it and the full frame
+    //   evenly: strips of 1 to 8 pixels per work item (groups of
+    //   UNROLLED_LANES pixels for the unrolled variant), in power of two
+    //   work groups of 16 to 512 items, or of the driver's choice. A single
+    //   launch is short enough to be noisy, so each shape takes the best
+    //   of two runs. Shapes stop being tried after TUNE_SECONDS
+    std::vector<size_t> max_item_sizes =
+        device->getInfo<CL_DEVICE_MAX_WORK_ITEM_SIZES>();
+    size_t max_group_size = device->getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>();
+    size_t tune_size = std::min(size, TUNE_SIZE);
+    size_t offset = sizeof(float) * ((size - tune_size) / 2);
+    cl::Buffer crop_re(*context, CL_MEM_READ_WRITE, sizeof(float) * tune_size);
+    cl::Buffer crop_im(*context, CL_MEM_READ_WRITE, sizeof(float) * tune_size);
+    queue->enqueueCopyBuffer(*buffer_re, crop_re, offset, 0,
+                             sizeof(float) * tune_size);
+    queue->enqueueCopyBuffer(*buffer_im, crop_im, offset, 0,
+                             sizeof(float) * tune_size);
+    cl::ImageFormat image_format(CL_RGBA, CL_UNSIGNED_INT8);
+    Attracting_Cycle attracting;
+    find_attracting_cycle(c_re, c_im, &attracting);
+    const unsigned int num_probes = 8;
+    std::vector<Julia_Set> probes(num_probes);
+    for (unsigned int i = 0; i < num_probes; i++)
+    {
+        probes[i] = Julia_Set(tune_size, &image_format, context);
+        probes[i].create_kernel(program, variant, &crop_re, &crop_im,
+                                cmap_buf, cmap_size, c_re, c_im, attracting,
+                                shared);
+    }
+    time_frames(&probes[0], 1, queue, 0, 0);
+    std::chrono::steady_clock::time_point tune_start =
+        std::chrono::steady_clock::now();
+    double best = -1.0;
+    unsigned int shapes = 0;
+    bool timed_out = false;
+    // The persistent, sorted and resumable variants size their own launches
+    size_t lanes = variant == KERNEL_UNROLLED ? UNROLLED_LANES : 1;
+    bool shaped = variant != KERNEL_PERSISTENT && variant != KERNEL_SORTED &&
+                  variant != KERNEL_RESUMABLE;
+    for (unsigned int strip = 1; strip <= 8 && shaped && !timed_out;
+         strip *= 2)
+    {
+        if (size % (strip * lanes) != 0 || tune_size % (strip * lanes) != 0)
+            continue;
+        size_t width = size / (strip * lanes);
+        size_t tune_width = tune_size / (strip * lanes);
+        std::vector<std::pair<size_t, size_t> > groups;
+        groups.push_back(std::make_pair(0, 0));
+        for (size_t w = 8; w <= 64 && w <= max_item_sizes[0]; w *= 2)
+        {
+            for (size_t h = 1; h <= 8 && h <= max_item_sizes[1] &&
+                               w * h <= max_group_size; h *= 2)
+            {
+                if (width % w == 0 && tune_width % w == 0 && size % h == 0 &&
+                    tune_size % h == 0 && w * h >= 16)
+                    groups.push_back(std::make_pair(w, h));
+            }
+        }
+        for (unsigned int g = 0; g < groups.size(); g++)
+        {
+            // Always time at least the driver's choice
+            if (shapes > 0 && std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - tune_start).count() >
+                TUNE_SECONDS)
+            {
+                timed_out = true;
+                break;
+            }
+            probes[0].set_launch_shape(groups[g].first, groups[g].second,
+                                       strip);
+            double seconds = std::min(time_frames(&probes[0], 1, queue, 0, 0),
+                                      time_frames(&probes[0], 1, queue, 0, 0));
+            shapes++;
+            if (best < 0.0 || seconds < best)
+            {
+                best = seconds;
+                profile->local_width = groups[g].first;
+                profile->local_height = groups[g].second;
+                profile->strip = strip;
+            }
+        }
+    }
+
+    // Then time a few frames with that shape for how many frames to queue
+    //   before waiting for them (0 for all) and how often to flush the
+    //   queue, which trades keeping the device busy against host overhead
+    for (unsigned int i = 0; i < num_probes; i++)
+        probes[i].set_launch_shape(profile->local_width,
+                                   profile->local_height, profile->strip);
+    const unsigned int batches[] = {0, 1, 4};
+    const unsigned int flushes[] = {0, 1, 2};
+    best = -1.0;
+    for (unsigned int b = 0; b < 3; b++)
+    {
+        for (unsigned int f = 0; f < 3; f++)
+        {
+            // Waiting flushes the queue anyway
+            if (batches[b] > 0 && flushes[f] >= batches[b])
+                continue;
+            double seconds = time_frames(&probes[0], num_probes, queue,
+                                         batches[b], flushes[f]);
+            if (best < 0.0 || seconds < best)
+            {
+                best = seconds;
+                profile->batch_frames = batches[b];
+                profile->flush_frames = flushes[f];
+            }
+        }
+    }
+
+    std::cout << "Using ";
+    if (shapes == 0)
+        std::cout << "the " << variant_name(variant) << " launch";
+    else if (profile->local_width > 0)
+        std::cout << profile->local_width << "x" << profile->local_height
+                  << " work groups";
+    else
+        std::cout << "driver chosen work groups";
+    if (shapes > 0)
+        std::cout << " of " << profile->strip << " pixel strips (fastest of "
+                  << shapes << " launch shapes on a " << tune_size << "x"
+                  << tune_size << " crop" << (timed_out ? ", out of time" : "")
+                  << ")";
+    std::cout << ", waiting for ";
+    if (profile->batch_frames > 0)
+        std::cout << "every " << profile->batch_frames << " frames";
+    else
+        std::cout << "all frames";
+    if (profile->flush_frames > 0)
+        std::cout << " and flushing every " << profile->flush_frames
+                  << " frames";
+    std::cout << std::endl;
+}
+
+
+void create_variant_buffers(cl::Context* context, cl::CommandQueue* queue,
+                            size_t size, Variant_Buffers* shared)
+{
+    // Buffers the double variants share between frames, see
+    //   Variant_Buffers. The sorted variant orders the first frame by
+    //   depths of 0
+    shared->flagged = cl::Buffer(*context, CL_MEM_READ_WRITE,
+                                 sizeof(cl_uint) * size * size);
+    shared->flagged_count = cl::Buffer(*context, CL_MEM_READ_WRITE,
+                                       sizeof(cl_uint));
+    shared->depths = cl::Buffer(*context, CL_MEM_READ_WRITE, size * size);
+    shared->order = cl::Buffer(*context, CL_MEM_READ_WRITE,
+                               sizeof(cl_uint) * size * size);
+    shared->bins = cl::Buffer(*context, CL_MEM_READ_WRITE,
+                              sizeof(cl_uint) * 256);
+    cl_uchar zero = 0;
+    queue->enqueueFillBuffer(shared->depths, zero, 0, size * size);
+    for (unsigned int k = 0; k < 2; k++)
+    {
+        shared->states[k] = cl::Buffer(*context, CL_MEM_READ_WRITE,
+                                       RESUME_STATE_SIZE * size * size);
+        shared->state_counts[k] = cl::Buffer(*context, CL_MEM_READ_WRITE,
+                                             sizeof(cl_uint));
+    }
+}
+
+
+Kernel_Variant profiled_variant(bool has_fp64, cl::Device* device,
+                                cl::Context* context,
+                                cl::CommandQueue* queue,
+                                cl::Program* program,
+                                cl::Kernel* spaced_re_kernel,
+                                cl::Kernel* spaced_im_kernel,
+                                cl::Buffer* buffer_re, cl::Buffer* buffer_im,
+                                cl::Buffer* cmap_buf, unsigned int cmap_size,
+                                Variant_Buffers* shared, size_t size,
+                                float c_re, float c_im, bool profiled,
+                                const std::string& profile_path,
+                                Device_Profile* profile)
+{
+    // Variant of plain frames from the device's profile, or benchmarked
+    //   with the launch shape and saved to it if the profile is for
+    //   another size, there is none, or it is from before variants had to
+    //   compute double's depths to be chosen
+    if (profiled && profile->size == size && profile->checked &&
+        profile->variant >= 0 &&
+        profile->variant < KERNEL_VARIANTS &&
+        profile->variant != KERNEL_PERTURBED)
+    {
+        Kernel_Variant variant = (Kernel_Variant)profile->variant;
+        // The profile compared the variant against double on the grid of
+        //   the run that saved it, which this one needn't share
+        if (has_fp64 && (variant == KERNEL_FLOAT_FLOAT ||
+                         variant == KERNEL_FIXED) &&
+            !same_depths_as_double(variant, context, queue, program,
+                                   spaced_re_kernel, spaced_im_kernel,
+                                   buffer_re, buffer_im, shared, size, c_re,
+                                   c_im))
+        {
+            std::cout << "Using double arithmetic, " << variant_name(variant)
+                      << " from " << profile_path << " computes other "
+                      << "depths on this frame, and its launch shape"
+                      << std::endl;
+            return KERNEL_DOUBLE;
+        }
+        std::cout << "Using " << variant_name(variant)
+                  << " arithmetic and launch shape from " << profile_path
+                  << std::endl;
+        return variant;
+    }
+    Kernel_Variant variant = choose_image_variant(has_fp64, context, queue,
+                                                  program, spaced_re_kernel,
+                                                  spaced_im_kernel,
+                                                  buffer_re, buffer_im,
+                                                  shared, size, c_re, c_im);
+    profile->size = size;
+    profile->variant = variant;
+    profile->checked = 1;
+    tune_launch(variant, device, context, queue, program, buffer_re,
+                buffer_im, cmap_buf, cmap_size, shared, size, c_re, c_im,
+                profile);
+    if (save_device_profile(profile_path, *profile))
+        std::cout << "Saved device profile to " << profile_path << std::endl;
+    return variant;
+}
+
+
+double time_frames(Julia_Set* probes, unsigned int count,
+                   cl::CommandQueue* queue, unsigned int batch_frames,
+                   unsigned int flush_frames)
+{
+    // Seconds to render the probe frames, queued like the main render loop
+    //   queues frames
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < count; i++)
+    {
+        probes[i].queue_kernel(queue);
+        if (flush_frames > 0 && (i + 1) % flush_frames == 0)
+            queue->flush();
+        if (batch_frames > 0 && (i + 1) % batch_frames == 0)
+            queue->finish();
+    }
+    queue->finish();
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+
+size_t render_split_frames(std::vector<Julia_Set>* frames,
+                           cl::CommandQueue* queue, size_t size,
+                           const std::vector<float>& spaced_re,
+                           const std::vector<float>& spaced_im,
+                           const cl_uint4* cmap)
+{
+    // Render the last rows of every frame on the host while the device
+    //   renders the others, and return how many rows the host rendered.
+    //   The device stays a frame ahead: frame i + 1 is queued before the
+    //   host renders the rows of frame i. After every frame the split
+    //   moves to where both would have finished at once, going by their
+    //   rows per second on it, starting with a sixteenth on the host
+    unsigned int num_frames = frames->size();
+    std::vector<size_t> rows(num_frames, 0);
+    cl::Event done[2];
+    size_t host_rows = std::max<size_t>(1, size / 16);
+    size_t host_total = 0;
+    if (num_frames == 0)
+        return 0;
+    rows[0] = host_rows;
+    (*frames)[0].set_host_rows(rows[0]);
+    (*frames)[0].queue_kernel(queue, &done[0]);
+    queue->flush();
+    for (unsigned int i = 0; i < num_frames; i++)
+    {
+        if (i + 1 < num_frames)
+        {
+            rows[i + 1] = host_rows;
+            (*frames)[i + 1].set_host_rows(rows[i + 1]);
+            (*frames)[i + 1].queue_kernel(queue, &done[(i + 1) % 2]);
+            queue->flush();
+        }
+        std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+        (*frames)[i].render_host_rows(spaced_re, spaced_im, cmap);
+        double host_seconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+        done[i % 2].wait();
+        double device_seconds = 1e-9 * (
+            done[i % 2].getProfilingInfo<CL_PROFILING_COMMAND_END>() -
+            done[i % 2].getProfilingInfo<CL_PROFILING_COMMAND_START>());
+        host_total += rows[i];
+        double device_rate = (size - rows[i]) /
+                             std::max(device_seconds, 1e-9);
+        double host_rate = rows[i] / std::max(host_seconds, 1e-9);
+        host_rows = (size_t)(size * host_rate / (host_rate + device_rate) +
+                             0.5);
+        // Keep a row on each side, so both keep being timed
+        host_rows = std::max<size_t>(1, std::min(host_rows, size - 1));
+    }
+    return host_total;
+}
+
+
+const char* variant_name(Kernel_Variant variant)
+{
+    switch (variant)
+    {
+        case KERNEL_FLOAT_FLOAT: return "float-float";
+        case KERNEL_PERTURBED: return "perturbation";
+        case KERNEL_MIXED: return "float then double";
+        case KERNEL_FIXED: return "fixed point";
+        case KERNEL_UNROLLED: return "unrolled double";
+        case KERNEL_PERSISTENT: return "persistent double";
+        case KERNEL_SORTED: return "sorted double";
+        case KERNEL_RESUMABLE: return "resumable double";
+        default: return "double";
+    }
+}
+
+
+Kernel_Variant frame_variant(double extent, double pixel_size,
+                             Kernel_Variant fast_variant, bool has_fp64,
+                             bool deep)
+{
+    // Mantissa bits that tell apart the pixels of a frame whose coordinates
+    //   reach extent, plus a margin for the rounding errors that build up
+    //   over 255 iterations. The margin is a conservative guess, not a
+    //   bound: nothing here shows a variant's depths match double's, only
+    //   the comparison in choose_image_variant does
+    const double guard_bits = 40.0;
+    double bits = log2(extent / pixel_size) + guard_bits;
+    // Without doubles there is nothing to compare against. Fixed point has
+    //   52 fraction bits however small the extent is
+    if (!has_fp64)
+    {
+        if (fast_variant == KERNEL_FIXED &&
+            log2(1.0 / pixel_size) + guard_bits > 52.0)
+            return KERNEL_FLOAT_FLOAT;
+        return fast_variant;
+    }
+    // Plain frames all use the grid choose_image_variant (or
+    //   profiled_variant, for a profile's variant) compared against double,
+    //   so the fast variant computes double's depths for them
+    if (!deep)
+        return fast_variant;
+    // Deep zooms make a grid per frame that nothing compared, so they keep
+    //   to double and the variants that compute exactly what it does (mixed
+    //   certifies its float pass and falls back to double), then go on to
+    //   perturbation once the pixels get too close for double
+    if (bits <= 53.0)
+        return (fast_variant == KERNEL_MIXED ||
+                fast_variant == KERNEL_UNROLLED ||
+                fast_variant == KERNEL_PERSISTENT ||
+                fast_variant == KERNEL_SORTED ||
+                fast_variant == KERNEL_RESUMABLE) ? fast_variant
+                                                  : KERNEL_DOUBLE;
+    return KERNEL_PERTURBED;
+}
+
+
 cl_uint4* colormap(std::string filename, unsigned int* size)
 {
     std::vector<unsigned char> image;
@@ -353,6 +2064,25 @@ cl_uint4* colormap(std::string filename, unsigned int* size)
 }
 
 
+std::vector<unsigned char> depth_palette(cl_uint4* cmap,
+                                         unsigned int cmap_size)
+{
+    // Return the RGBA colors render_image gives depths 0 to 255, which are
+    //   all the colors a frame can contain (at most 256, so a PNG or GIF
+    //   palette can be used without any quantization)
+    std::vector<unsigned char> palette;
+    for (unsigned int depth = 0; depth <= 255; depth++)
+    {
+        unsigned int color_index = (float)(depth - 0) /
+                                   (float)(255 - 0) * cmap_size;
+        color_index = std::min(color_index, cmap_size - 1);
+        for (unsigned int i = 0; i < 4; i++)
+            palette.push_back((unsigned char)cmap[color_index].s[i]);
+    }
+    return palette;
+}
+
+
 std::string ts(time_t* start_time)
 {   
     // Return string with time difference from start of execution
@@ -362,3 +2092,42 @@ std::string ts(time_t* start_time)
 }
 
 
+void print_usage(void)
+{
+    std::cerr << "Usage: ./render <video size in px> <colormap png> [options]"
+              << std::endl
+              << "       ./render recolor <field archive> <colormap png> "
+              << "[--format=mp4|apng|gif|qoi]" << std::endl
+              << "Options:" << std::endl
+              << "\t--format=mp4|apng|gif|qoi|field  Output out.mp4 through "
+              << "PPM frames and ffmpeg (default), a lossless animated "
+              << "out.png, an animated out.gif, QOI frames in frames/, or an "
+              << "iteration field archive out.jfa to recolor later"
+              << std::endl
+              << "\t--cycle  Compute the first frame's julia set once and "
+              << "animate it by cycling the colormap" << std::endl
+              << "\t--incremental  Reuse depths between frames where they "
+              << "provably can't change (exact)" << std::endl
+              << "\t--vectorize  Render four frames per work item, one per "
+              << "vector lane (for CPUs and wide SIMD GPUs)" << std::endl
+              << "\t--deep=<re>,<im>,<zoom>[,<factor>]  Zoom in beyond double "
+              << "precision on a center given as decimal numbers, with the "
+              << "zoom multiplied by factor every frame" << std::endl
+              << "\t--adaptive[=<fraction>]  Limit the iterations of each "
+              << "frame to what a low resolution probe of it needs, letting "
+              << "at most the fraction (default 0.001) of pixels that escape "
+              << "later count as never escaping" << std::endl
+              << "\t--all-devices  Render frames on every OpenCL device of "
+              << "every platform at once, handing each device frames as it "
+              << "finishes them" << std::endl
+              << "\t--split  Render the last rows of each frame on the host's "
+              << "CPU cores while the device renders the rest, with a share "
+              << "that follows their speed on the frame before" << std::endl
+              << "\t--device=<index>|<name>|auto  OpenCL device to render "
+              << "on, by its number in the list, part of its name, or the "
+              << "fastest at a plain frame (also RENDER_DEVICE, auto "
+              << "without a terminal)" << std::endl
+              << "\t--verify  Decode every QOI frame again after writing it "
+              << "and stop unless it matches the rendered image byte for "
+              << "byte (with --format=qoi)" << std::endl;
+}